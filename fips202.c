@@ -326,35 +326,6 @@ void KeccakF1600_StatePermute(uint64_t * state)
     state[24] = Asu;
 }
 
-static void keccak_absorb(uint64_t *s, unsigned int r,
-                          const unsigned char *m, unsigned long long mlen,
-                          unsigned char p)
-{
-    unsigned long long i;
-    unsigned char t[200];
-
-    while (mlen >= r) {
-        for (i = 0; i < r / 8; ++i) {
-            s[i] ^= load64(m + 8 * i);
-        }
-        KeccakF1600_StatePermute(s);
-        mlen -= r;
-        m += r;
-    }
-
-    for (i = 0; i < r; ++i) {
-        t[i] = 0;
-    }
-    for (i = 0; i < mlen; ++i) {
-        t[i] = m[i];
-    }
-    t[i] = p;
-    t[r - 1] |= 128;
-    for (i = 0; i < r / 8; ++i) {
-        s[i] ^= load64(t + 8 * i);
-    }
-}
-
 static void keccak_squeezeblocks(unsigned char *h, unsigned long long nblocks,
                                  uint64_t *s, unsigned int r)
 {
@@ -370,48 +341,119 @@ static void keccak_squeezeblocks(unsigned char *h, unsigned long long nblocks,
     }
 }
 
-void shake128(unsigned char *out, unsigned long long outlen,
-              const unsigned char *in, unsigned long long inlen)
+static void shake_inc_init(shake_ctx *ctx, unsigned int rate)
 {
-    unsigned long long i;
-    uint64_t s[25];
-    unsigned char d[SHAKE128_RATE];
+    unsigned int i;
 
     for (i = 0; i < 25; i++) {
-        s[i] = 0;
+        ctx->s[i] = 0;
     }
-    keccak_absorb(s, SHAKE128_RATE, in, inlen, 0x1F);
+    ctx->rate = rate;
+    ctx->pos = 0;
+}
+
+void shake128_inc_init(shake_ctx *ctx)
+{
+    shake_inc_init(ctx, SHAKE128_RATE);
+}
+
+void shake256_inc_init(shake_ctx *ctx)
+{
+    shake_inc_init(ctx, SHAKE256_RATE);
+}
 
-    keccak_squeezeblocks(out, outlen / SHAKE128_RATE, s, SHAKE128_RATE);
-    out += (outlen / SHAKE128_RATE) * SHAKE128_RATE;
+void shake_inc_absorb(shake_ctx *ctx,
+                      const unsigned char *in, unsigned long long inlen)
+{
+    unsigned int i;
 
-    if (outlen % SHAKE128_RATE) {
-        keccak_squeezeblocks(d, 1, s, SHAKE128_RATE);
-        for (i = 0; i < outlen % SHAKE128_RATE; i++) {
-            out[i] = d[i];
+    /* Complete a partially absorbed block. */
+    while (ctx->pos > 0 && inlen > 0) {
+        ctx->s[ctx->pos >> 3] ^= (uint64_t)*in << (8 * (ctx->pos & 7));
+        in++;
+        inlen--;
+        ctx->pos++;
+        if (ctx->pos == ctx->rate) {
+            KeccakF1600_StatePermute(ctx->s);
+            ctx->pos = 0;
         }
     }
+    if (ctx->pos > 0) {
+        return;
+    }
+
+    while (inlen >= ctx->rate) {
+        for (i = 0; i < ctx->rate / 8; ++i) {
+            ctx->s[i] ^= load64(in + 8 * i);
+        }
+        KeccakF1600_StatePermute(ctx->s);
+        inlen -= ctx->rate;
+        in += ctx->rate;
+    }
+
+    for (i = 0; i < inlen; i++) {
+        ctx->s[i >> 3] ^= (uint64_t)in[i] << (8 * (i & 7));
+    }
+    ctx->pos = inlen;
 }
 
-void shake256(unsigned char *output, unsigned long long outlen,
-              const unsigned char *in, unsigned long long inlen)
+void shake_inc_finalize(shake_ctx *ctx)
 {
-    unsigned long long i;
-    uint64_t s[25];
-    unsigned char d[SHAKE256_RATE];
+    ctx->s[ctx->pos >> 3] ^= (uint64_t)0x1F << (8 * (ctx->pos & 7));
+    ctx->s[(ctx->rate - 1) >> 3] ^= (uint64_t)128 << (8 * ((ctx->rate - 1) & 7));
+    /* The first squeeze starts with a permutation. */
+    ctx->pos = ctx->rate;
+}
 
-    for (i = 0; i < 25; i++) {
-        s[i] = 0;
+void shake_inc_squeeze(unsigned char *out, unsigned long long outlen,
+                       shake_ctx *ctx)
+{
+    unsigned long long nblocks;
+
+    /* Use up what is left of the current block. */
+    while (ctx->pos < ctx->rate && outlen > 0) {
+        *out = ctx->s[ctx->pos >> 3] >> (8 * (ctx->pos & 7));
+        out++;
+        outlen--;
+        ctx->pos++;
     }
-    keccak_absorb(s, SHAKE256_RATE, in, inlen, 0x1F);
 
-    keccak_squeezeblocks(output, outlen / SHAKE256_RATE, s, SHAKE256_RATE);
-    output += (outlen / SHAKE256_RATE) * SHAKE256_RATE;
+    nblocks = outlen / ctx->rate;
+    keccak_squeezeblocks(out, nblocks, ctx->s, ctx->rate);
+    out += nblocks * ctx->rate;
+    outlen -= nblocks * ctx->rate;
 
-    if (outlen % SHAKE256_RATE) {
-        keccak_squeezeblocks(d, 1, s, SHAKE256_RATE);
-        for (i = 0; i < outlen % SHAKE256_RATE; i++) {
-            output[i] = d[i];
+    if (outlen > 0) {
+        KeccakF1600_StatePermute(ctx->s);
+        for (ctx->pos = 0; ctx->pos < outlen; ctx->pos++) {
+            out[ctx->pos] = ctx->s[ctx->pos >> 3] >> (8 * (ctx->pos & 7));
         }
     }
 }
+
+void shake_inc_clone(shake_ctx *dest, const shake_ctx *src)
+{
+    memcpy(dest, src, sizeof(shake_ctx));
+}
+
+void shake128(unsigned char *out, unsigned long long outlen,
+              const unsigned char *in, unsigned long long inlen)
+{
+    shake_ctx ctx;
+
+    shake128_inc_init(&ctx);
+    shake_inc_absorb(&ctx, in, inlen);
+    shake_inc_finalize(&ctx);
+    shake_inc_squeeze(out, outlen, &ctx);
+}
+
+void shake256(unsigned char *output, unsigned long long outlen,
+              const unsigned char *in, unsigned long long inlen)
+{
+    shake_ctx ctx;
+
+    shake256_inc_init(&ctx);
+    shake_inc_absorb(&ctx, in, inlen);
+    shake_inc_finalize(&ctx);
+    shake_inc_squeeze(output, outlen, &ctx);
+}
@@ -4,6 +4,17 @@
 #define SHAKE128_RATE 168
 #define SHAKE256_RATE 136
 
+#include <stdint.h>
+
+/* State of an incremental SHAKE computation. The state may be copied at any
+ * point, e.g. with shake_inc_clone, to continue from there more than once.
+ */
+typedef struct {
+    uint64_t s[25];
+    unsigned int rate;
+    unsigned int pos;
+} shake_ctx;
+
 /* Evaluates SHAKE-128 on `inlen' bytes in `in', according to FIPS-202.
  * Writes the first `outlen` bytes of output to `out`.
  */
@@ -16,4 +27,28 @@ void shake128(unsigned char *out, unsigned long long outlen,
 void shake256(unsigned char *out, unsigned long long outlen,
               const unsigned char *in, unsigned long long inlen);
 
+/* Initializes ctx for an incremental SHAKE-128 or SHAKE-256 computation. */
+void shake128_inc_init(shake_ctx *ctx);
+
+void shake256_inc_init(shake_ctx *ctx);
+
+/* Absorbs `inlen' bytes from `in'; can be called any number of times. */
+void shake_inc_absorb(shake_ctx *ctx,
+                      const unsigned char *in, unsigned long long inlen);
+
+/* Completes the input, after which no more bytes can be absorbed. */
+void shake_inc_finalize(shake_ctx *ctx);
+
+/* Writes the next `outlen' bytes of output to `out`. Can be called any
+ * number of times after shake_inc_finalize; the output of several calls
+ * is the same as that of one call for their total length.
+ */
+void shake_inc_squeeze(unsigned char *out, unsigned long long outlen,
+                       shake_ctx *ctx);
+
+/* Copies the state in `src' to `dest', e.g. to continue from a prefix that
+ * has been absorbed once.
+ */
+void shake_inc_clone(shake_ctx *dest, const shake_ctx *src);
+
 #endif
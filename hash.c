@@ -1,3 +1,7 @@
+/* The low-level SHA2 functions are deprecated as of OpenSSL 3.0, but their
+   state is the only one that can be copied without allocating. */
+#define OPENSSL_SUPPRESS_DEPRECATED
+
 #include <stdint.h>
 #include <string.h>
 #include <openssl/sha.h>
@@ -8,11 +12,15 @@
 #include "hash.h"
 #include "fips202.h"
 
-#define XMSS_HASH_PADDING_F 0
-#define XMSS_HASH_PADDING_H 1
-#define XMSS_HASH_PADDING_HASH 2
-#define XMSS_HASH_PADDING_PRF 3
-#define XMSS_HASH_PADDING_PRF_KEYGEN 4
+#ifdef XMSS_HASH_STATS
+static __thread xmss_hash_stats hash_stats;
+
+#define COUNT_CALL(domain) (hash_stats.calls[(domain)]++)
+#define COUNT_BYTES(domain, len) (hash_stats.bytes[(domain)] += (len))
+#else
+#define COUNT_CALL(domain)
+#define COUNT_BYTES(domain, len)
+#endif
 
 void addr_to_bytes(unsigned char *bytes, const uint32_t addr[8])
 {
@@ -22,11 +30,20 @@ void addr_to_bytes(unsigned char *bytes, const uint32_t addr[8])
     }
 }
 
-static int core_hash(const xmss_params *params,
-                     unsigned char *out,
-                     const unsigned char *in, unsigned long long inlen)
+int core_hash(const xmss_params *params,
+              unsigned char *out,
+              const unsigned char *in, unsigned long long inlen)
 {
     unsigned char buf[64];
+#ifdef XMSS_HASH_STATS
+    /* All inputs start with their padding, which identifies the domain. */
+    unsigned long long domain = bytes_to_ull(in, params->padding_len);
+
+    if (domain < XMSS_HASH_DOMAINS) {
+        COUNT_CALL(domain);
+        COUNT_BYTES(domain, inlen);
+    }
+#endif
 
     if (params->n == 24 && params->func == XMSS_SHA2) {
         SHA256(in, inlen, buf);
@@ -56,6 +73,62 @@ static int core_hash(const xmss_params *params,
     return 0;
 }
 
+/*
+ * Hashes inlen bytes with the digest of ctx, or with core_hash when there
+ * is no ctx. An input that starts at ctx->prf_in resumes from a copy of the
+ * state that has absorbed its prefix.
+ */
+static int ctx_hash(const xmss_params *params, xmss_thash_ctx *ctx,
+                    unsigned char *out,
+                    const unsigned char *in, unsigned long long inlen)
+{
+    unsigned int prefix = 0;
+    unsigned char buf[64];
+    union {
+        SHA256_CTX sha256;
+        SHA512_CTX sha512;
+    } work;
+
+    if (ctx == NULL || !ctx->sha2) {
+        return core_hash(params, out, in, inlen);
+    }
+#ifdef XMSS_HASH_STATS
+    {
+        unsigned long long domain = bytes_to_ull(in, params->padding_len);
+
+        if (domain < XMSS_HASH_DOMAINS) {
+            COUNT_CALL(domain);
+            COUNT_BYTES(domain, inlen);
+        }
+    }
+#endif
+    if (in == ctx->prf_in) {
+        prefix = params->padding_len + params->n;
+    }
+    if (params->n == 64) {
+        if (prefix) {
+            work.sha512 = ctx->seeded.sha512;
+        }
+        else {
+            SHA512_Init(&work.sha512);
+        }
+        SHA512_Update(&work.sha512, in + prefix, inlen - prefix);
+        SHA512_Final(buf, &work.sha512);
+    }
+    else {
+        if (prefix) {
+            work.sha256 = ctx->seeded.sha256;
+        }
+        else {
+            SHA256_Init(&work.sha256);
+        }
+        SHA256_Update(&work.sha256, in + prefix, inlen - prefix);
+        SHA256_Final(buf, &work.sha256);
+    }
+    memcpy(out, buf, params->n);
+    return 0;
+}
+
 /*
  * Computes PRF(key, in), for a key of params->n bytes, and a 32-byte input.
  */
@@ -63,13 +136,20 @@ int prf(const xmss_params *params,
         unsigned char *out, const unsigned char in[32],
         const unsigned char *key)
 {
-    unsigned char buf[params->padding_len + params->n + 32];
+    return prf_ctx(params, NULL, out, in, key);
+}
+
+int prf_ctx(const xmss_params *params, xmss_thash_ctx *ctx,
+            unsigned char *out, const unsigned char in[32],
+            const unsigned char *key)
+{
+    unsigned char buf[2*XMSS_HASH_MAX_N + 32];
 
     ull_to_bytes(buf, params->padding_len, XMSS_HASH_PADDING_PRF);
     memcpy(buf + params->padding_len, key, params->n);
     memcpy(buf + params->padding_len + params->n, in, 32);
 
-    return core_hash(params, out, buf, params->padding_len + params->n + 32);
+    return ctx_hash(params, ctx, out, buf, params->padding_len + params->n + 32);
 }
 
 /*
@@ -80,13 +160,21 @@ int prf_keygen(const xmss_params *params,
         unsigned char *out, const unsigned char *in,
         const unsigned char *key)
 {
-    unsigned char buf[params->padding_len + 2*params->n + 32];
+    return prf_keygen_ctx(params, NULL, out, in, key);
+}
+
+int prf_keygen_ctx(const xmss_params *params, xmss_thash_ctx *ctx,
+                   unsigned char *out, const unsigned char *in,
+                   const unsigned char *key)
+{
+    unsigned char buf[3*XMSS_HASH_MAX_N + 32];
 
     ull_to_bytes(buf, params->padding_len, XMSS_HASH_PADDING_PRF_KEYGEN);
     memcpy(buf + params->padding_len, key, params->n);
     memcpy(buf + params->padding_len + params->n, in, params->n + 32);
 
-    return core_hash(params, out, buf, params->padding_len + 2*params->n + 32);
+    return ctx_hash(params, ctx, out, buf,
+                    params->padding_len + 2*params->n + 32);
 }
 
 /*
@@ -100,6 +188,16 @@ int hash_message(const xmss_params *params, unsigned char *out,
                  const unsigned char *R, const unsigned char *root,
                  unsigned long long idx,
                  unsigned char *m_with_prefix, unsigned long long mlen)
+{
+    return hash_message_ctx(params, NULL, out, R, root, idx,
+                            m_with_prefix, mlen);
+}
+
+int hash_message_ctx(const xmss_params *params, xmss_thash_ctx *ctx,
+                     unsigned char *out,
+                     const unsigned char *R, const unsigned char *root,
+                     unsigned long long idx,
+                     unsigned char *m_with_prefix, unsigned long long mlen)
 {
     /* We're creating a hash using input of the form:
        toByte(X, 32) || R || root || index || M */
@@ -108,7 +206,89 @@ int hash_message(const xmss_params *params, unsigned char *out,
     memcpy(m_with_prefix + params->padding_len + params->n, root, params->n);
     ull_to_bytes(m_with_prefix + params->padding_len + 2*params->n, params->n, idx);
 
-    return core_hash(params, out, m_with_prefix, mlen + params->padding_len + 3*params->n);
+    return ctx_hash(params, ctx, out, m_with_prefix,
+                    mlen + params->padding_len + 3*params->n);
+}
+
+int hash_message_init(const xmss_params *params, xmss_hash_msg_ctx *ctx,
+                      const unsigned char *R, const unsigned char *root,
+                      unsigned long long idx)
+{
+    unsigned char prefix[4*XMSS_HASH_MAX_N];
+    const EVP_MD *md = NULL;
+
+    ull_to_bytes(prefix, params->padding_len, XMSS_HASH_PADDING_HASH);
+    memcpy(prefix + params->padding_len, R, params->n);
+    memcpy(prefix + params->padding_len + params->n, root, params->n);
+    ull_to_bytes(prefix + params->padding_len + 2*params->n, params->n, idx);
+
+    ctx->sha2 = NULL;
+    if ((params->n == 24 || params->n == 32) && params->func == XMSS_SHA2) {
+        md = EVP_sha256();
+    }
+    else if (params->n == 64 && params->func == XMSS_SHA2) {
+        md = EVP_sha512();
+    }
+    else if (params->n == 32 && params->func == XMSS_SHAKE128) {
+        shake128_inc_init(&ctx->shake);
+    }
+    else if ((params->n == 24 || params->n == 32 || params->n == 64) &&
+             params->func == XMSS_SHAKE256) {
+        shake256_inc_init(&ctx->shake);
+    }
+    else {
+        return -1;
+    }
+    if (md != NULL) {
+        ctx->sha2 = EVP_MD_CTX_new();
+        if (ctx->sha2 == NULL || !EVP_DigestInit_ex(ctx->sha2, md, NULL)) {
+            EVP_MD_CTX_free(ctx->sha2);
+            return -1;
+        }
+    }
+    COUNT_CALL(XMSS_HASH_PADDING_HASH);
+    if (hash_message_update(params, ctx, prefix,
+                            params->padding_len + 3*params->n)) {
+        EVP_MD_CTX_free(ctx->sha2);
+        return -1;
+    }
+    return 0;
+}
+
+int hash_message_update(const xmss_params *params, xmss_hash_msg_ctx *ctx,
+                        const unsigned char *m, unsigned long long mlen)
+{
+    COUNT_BYTES(XMSS_HASH_PADDING_HASH, mlen);
+    if (params->func == XMSS_SHA2) {
+        if (!EVP_DigestUpdate(ctx->sha2, m, mlen)) {
+            return -1;
+        }
+    }
+    else {
+        shake_inc_absorb(&ctx->shake, m, mlen);
+    }
+    return 0;
+}
+
+int hash_message_final(const xmss_params *params, xmss_hash_msg_ctx *ctx,
+                       unsigned char *out)
+{
+    unsigned char buf[64];
+    int ret = 0;
+
+    if (params->func == XMSS_SHA2) {
+        if (!EVP_DigestFinal_ex(ctx->sha2, buf, NULL)) {
+            ret = -1;
+        }
+        EVP_MD_CTX_free(ctx->sha2);
+        ctx->sha2 = NULL;
+        memcpy(out, buf, params->n);
+    }
+    else {
+        shake_inc_finalize(&ctx->shake);
+        shake_inc_squeeze(out, params->n, &ctx->shake);
+    }
+    return ret;
 }
 
 /**
@@ -118,8 +298,8 @@ int thash_h(const xmss_params *params,
             unsigned char *out, const unsigned char *in,
             const unsigned char *pub_seed, uint32_t addr[8])
 {
-    unsigned char buf[params->padding_len + 3 * params->n];
-    unsigned char bitmask[2 * params->n];
+    unsigned char buf[4 * XMSS_HASH_MAX_N];
+    unsigned char bitmask[2 * XMSS_HASH_MAX_N];
     unsigned char addr_as_bytes[32];
     unsigned int i;
 
@@ -150,8 +330,8 @@ int thash_f(const xmss_params *params,
             unsigned char *out, const unsigned char *in,
             const unsigned char *pub_seed, uint32_t addr[8])
 {
-    unsigned char buf[params->padding_len + 2 * params->n];
-    unsigned char bitmask[params->n];
+    unsigned char buf[3 * XMSS_HASH_MAX_N];
+    unsigned char bitmask[XMSS_HASH_MAX_N];
     unsigned char addr_as_bytes[32];
     unsigned int i;
 
@@ -173,3 +353,142 @@ int thash_f(const xmss_params *params,
     }
     return core_hash(params, out, buf, params->padding_len + 2 * params->n);
 }
+
+void thash_ctx_init(const xmss_params *params, xmss_thash_ctx *ctx,
+                    const unsigned char *pub_seed)
+{
+    /* For SHAKE, the input of a PRF fits in one block either way. */
+    ctx->sha2 = params->func == XMSS_SHA2 &&
+                (params->n == 24 || params->n == 32 || params->n == 64);
+    thash_ctx_seed(params, ctx, pub_seed);
+}
+
+void thash_ctx_seed(const xmss_params *params, xmss_thash_ctx *ctx,
+                    const unsigned char *pub_seed)
+{
+    ull_to_bytes(ctx->prf_in, params->padding_len, XMSS_HASH_PADDING_PRF);
+    memcpy(ctx->prf_in + params->padding_len, pub_seed, params->n);
+
+    if (ctx->sha2 && params->n == 64) {
+        SHA512_Init(&ctx->seeded.sha512);
+        SHA512_Update(&ctx->seeded.sha512, ctx->prf_in,
+                      params->padding_len + params->n);
+    }
+    else if (ctx->sha2) {
+        SHA256_Init(&ctx->seeded.sha256);
+        SHA256_Update(&ctx->seeded.sha256, ctx->prf_in,
+                      params->padding_len + params->n);
+    }
+}
+
+void thash_ctx_share(const xmss_params *params, xmss_thash_ctx *ctx,
+                     const xmss_thash_ctx *from)
+{
+    (void)params;
+    *ctx = *from;
+}
+
+void thash_ctx_release(xmss_thash_ctx *ctx)
+{
+    memset(ctx, 0, sizeof(xmss_thash_ctx));
+}
+
+int thash_f_ctx(const xmss_params *params, xmss_thash_ctx *ctx,
+                unsigned char *out, const unsigned char *in,
+                uint32_t addr[8])
+{
+    unsigned char buf[3 * XMSS_HASH_MAX_N];
+    unsigned char bitmask[XMSS_HASH_MAX_N];
+    unsigned char *prf_addr = ctx->prf_in + params->padding_len + params->n;
+    unsigned int prf_len = params->padding_len + params->n + 32;
+    unsigned int i;
+
+    /* Set the function padding. */
+    ull_to_bytes(buf, params->padding_len, XMSS_HASH_PADDING_F);
+
+    /* Generate the n-byte key. */
+    set_key_and_mask(addr, 0);
+    addr_to_bytes(prf_addr, addr);
+    if (ctx_hash(params, ctx, buf + params->padding_len,
+                 ctx->prf_in, prf_len)) {
+        return -1;
+    }
+
+    /* Generate the n-byte mask. */
+    set_key_and_mask(addr, 1);
+    ull_to_bytes(prf_addr + 28, 4, 1);
+    if (ctx_hash(params, ctx, bitmask, ctx->prf_in, prf_len)) {
+        return -1;
+    }
+
+    for (i = 0; i < params->n; i++) {
+        buf[params->padding_len + params->n + i] = in[i] ^ bitmask[i];
+    }
+    return ctx_hash(params, ctx, out, buf, params->padding_len + 2 * params->n);
+}
+
+int thash_h_ctx(const xmss_params *params, xmss_thash_ctx *ctx,
+                unsigned char *out, const unsigned char *in,
+                uint32_t addr[8])
+{
+    unsigned char buf[4 * XMSS_HASH_MAX_N];
+    unsigned char bitmask[2 * XMSS_HASH_MAX_N];
+    unsigned char *prf_addr = ctx->prf_in + params->padding_len + params->n;
+    unsigned int prf_len = params->padding_len + params->n + 32;
+    unsigned int i;
+
+    /* Set the function padding. */
+    ull_to_bytes(buf, params->padding_len, XMSS_HASH_PADDING_H);
+
+    /* Generate the n-byte key. */
+    set_key_and_mask(addr, 0);
+    addr_to_bytes(prf_addr, addr);
+    if (ctx_hash(params, ctx, buf + params->padding_len,
+                 ctx->prf_in, prf_len)) {
+        return -1;
+    }
+
+    /* Generate the 2n-byte mask. */
+    set_key_and_mask(addr, 1);
+    ull_to_bytes(prf_addr + 28, 4, 1);
+    if (ctx_hash(params, ctx, bitmask, ctx->prf_in, prf_len)) {
+        return -1;
+    }
+
+    set_key_and_mask(addr, 2);
+    ull_to_bytes(prf_addr + 28, 4, 2);
+    if (ctx_hash(params, ctx, bitmask + params->n, ctx->prf_in, prf_len)) {
+        return -1;
+    }
+
+    for (i = 0; i < 2 * params->n; i++) {
+        buf[params->padding_len + params->n + i] = in[i] ^ bitmask[i];
+    }
+    return ctx_hash(params, ctx, out, buf, params->padding_len + 3 * params->n);
+}
+
+void xmss_hash_stats_get(xmss_hash_stats *stats)
+{
+#ifdef XMSS_HASH_STATS
+    *stats = hash_stats;
+#else
+    memset(stats, 0, sizeof(xmss_hash_stats));
+#endif
+}
+
+void xmss_hash_stats_reset(void)
+{
+#ifdef XMSS_HASH_STATS
+    memset(&hash_stats, 0, sizeof(xmss_hash_stats));
+#endif
+}
+
+void xmss_hash_stats_add(xmss_hash_stats *total, const xmss_hash_stats *stats)
+{
+    unsigned int i;
+
+    for (i = 0; i < XMSS_HASH_DOMAINS; i++) {
+        total->calls[i] += stats->calls[i];
+        total->bytes[i] += stats->bytes[i];
+    }
+}
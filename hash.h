@@ -2,10 +2,67 @@
 #define XMSS_HASH_H
 
 #include <stdint.h>
+#include <openssl/evp.h>
+#include <openssl/sha.h>
 #include "params.h"
+#include "fips202.h"
+
+/* The domain separation paddings that start the input of every hash. */
+#define XMSS_HASH_PADDING_F 0
+#define XMSS_HASH_PADDING_H 1
+#define XMSS_HASH_PADDING_HASH 2
+#define XMSS_HASH_PADDING_PRF 3
+#define XMSS_HASH_PADDING_PRF_KEYGEN 4
+#define XMSS_HASH_DOMAINS 5
+
+/* Bound on n, and so on the padding, of every parameter set. */
+#define XMSS_HASH_MAX_N 64
+
+/**
+ * Counts of hash function calls and of the bytes they hashed, indexed by
+ * the XMSS_HASH_PADDING_ value of their domain. A message hash counts as
+ * one call of the HASH domain, also when it is computed incrementally.
+ */
+typedef struct {
+    unsigned long long calls[XMSS_HASH_DOMAINS];
+    unsigned long long bytes[XMSS_HASH_DOMAINS];
+} xmss_hash_stats;
+
+/* State of a message hash that is computed incrementally. */
+typedef struct {
+    EVP_MD_CTX *sha2;
+    shake_ctx shake;
+} xmss_hash_msg_ctx;
+
+/**
+ * The hash state that the _ctx functions keep across the many calls of a
+ * WOTS or tree operation, which all hash under the same pub_seed. For SHA2, every PRF
+ * resumes from a digest that has already absorbed the padding and pub_seed,
+ * and no call has to set up a digest of its own. The PRF input is kept in
+ * place, so that a call only rewrites its address.
+ * The digest is a plain struct, which a call copies by assignment, so that
+ * hashing with a ctx never allocates.
+ */
+typedef struct {
+    unsigned char prf_in[XMSS_HASH_MAX_N + XMSS_HASH_MAX_N + 32];
+    /* Set for SHA2, for which 'seeded' holds the PRF prefix. */
+    int sha2;
+    union {
+        SHA256_CTX sha256;
+        SHA512_CTX sha512;
+    } seeded;
+} xmss_thash_ctx;
 
 void addr_to_bytes(unsigned char *bytes, const uint32_t addr[8]);
 
+/**
+ * Computes the n-byte output of the hash function of params on inlen bytes.
+ * All other hash functions are built on this one.
+ */
+int core_hash(const xmss_params *params,
+              unsigned char *out,
+              const unsigned char *in, unsigned long long inlen);
+
 int prf(const xmss_params *params,
         unsigned char *out, const unsigned char in[32],
         const unsigned char *key);
@@ -27,9 +84,87 @@ int thash_f(const xmss_params *params,
             unsigned char *out, const unsigned char *in,
             const unsigned char *pub_seed, uint32_t addr[8]);
 
+/* Prepares ctx for calls of the _ctx functions under pub_seed. */
+void thash_ctx_init(const xmss_params *params, xmss_thash_ctx *ctx,
+                    const unsigned char *pub_seed);
+
+/* Switches an initialized ctx to another pub_seed. */
+void thash_ctx_seed(const xmss_params *params, xmss_thash_ctx *ctx,
+                    const unsigned char *pub_seed);
+
+/**
+ * Prepares ctx to hash as 'from' does, which thash_ctx_init has set up, by
+ * copying its state. Any number of such ctx, also on different threads, may
+ * be prepared from one 'from', as long as it is not reseeded meanwhile.
+ */
+void thash_ctx_share(const xmss_params *params, xmss_thash_ctx *ctx,
+                     const xmss_thash_ctx *from);
+
+/* Clears ctx. */
+void thash_ctx_release(xmss_thash_ctx *ctx);
+
+/**
+ * These compute the same as the functions without _ctx, with the hash state
+ * of ctx; thash_h_ctx and thash_f_ctx use its pub_seed.
+ */
+int prf_ctx(const xmss_params *params, xmss_thash_ctx *ctx,
+            unsigned char *out, const unsigned char in[32],
+            const unsigned char *key);
+
+int prf_keygen_ctx(const xmss_params *params, xmss_thash_ctx *ctx,
+                   unsigned char *out, const unsigned char *in,
+                   const unsigned char *key);
+
+int thash_h_ctx(const xmss_params *params, xmss_thash_ctx *ctx,
+                unsigned char *out, const unsigned char *in,
+                uint32_t addr[8]);
+
+int thash_f_ctx(const xmss_params *params, xmss_thash_ctx *ctx,
+                unsigned char *out, const unsigned char *in,
+                uint32_t addr[8]);
+
+int hash_message_ctx(const xmss_params *params, xmss_thash_ctx *ctx,
+                     unsigned char *out,
+                     const unsigned char *R, const unsigned char *root,
+                     unsigned long long idx,
+                     unsigned char *m_with_prefix, unsigned long long mlen);
+
 int hash_message(const xmss_params *params, unsigned char *out,
                  const unsigned char *R, const unsigned char *root,
                  unsigned long long idx,
                  unsigned char *m_with_prefix, unsigned long long mlen);
 
+/**
+ * Computes the same message hash as hash_message incrementally, so that the
+ * message needs neither to be in memory at once nor to have free space in
+ * front of it. The message is passed to hash_message_update in any number
+ * of parts, and hash_message_final writes the n-byte hash to out.
+ * Every successful hash_message_init has to be followed by
+ * hash_message_final, which releases the state, also when an update failed.
+ */
+int hash_message_init(const xmss_params *params, xmss_hash_msg_ctx *ctx,
+                      const unsigned char *R, const unsigned char *root,
+                      unsigned long long idx);
+
+int hash_message_update(const xmss_params *params, xmss_hash_msg_ctx *ctx,
+                        const unsigned char *m, unsigned long long mlen);
+
+int hash_message_final(const xmss_params *params, xmss_hash_msg_ctx *ctx,
+                       unsigned char *out);
+
+/**
+ * Hash-call accounting, which is only compiled in with -DXMSS_HASH_STATS;
+ * otherwise nothing is counted and all counts read as 0.
+ * The counters are kept per thread: to obtain the counts of a keygen, sign
+ * or verify call, reset them before the call and read them after it, on the
+ * same thread. Counts read on several threads are combined with
+ * xmss_hash_stats_add.
+ */
+void xmss_hash_stats_get(xmss_hash_stats *stats);
+
+void xmss_hash_stats_reset(void);
+
+/* Adds the counts in stats to those in total. */
+void xmss_hash_stats_add(xmss_hash_stats *total, const xmss_hash_stats *stats);
+
 #endif
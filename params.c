@@ -1,700 +1,292 @@
+#include <pthread.h>
 #include <stdint.h>
 #include <string.h>
 
 #include "params.h"
 #include "xmss_core.h"
 
-int xmss_str_to_oid(uint32_t *oid, const char *s)
+/*
+ * The registry of parameter sets. Every OID maps to an entry whose params
+ * are derived at compile time, except for sk_bytes, which depends on the
+ * core that is linked in and is filled in once on first use. Entries are
+ * indexed by OID - 1, and names are found through a hash index.
+ */
+
+#define PADDING_LEN(n) ((n) == 24 ? 4 : (n))
+#define INDEX_BYTES(h, d) ((d) == 1 ? 4 : ((h) + 7) / 8)
+/* For w = 16: len_1 = 8n / log(w) and len_2 = 3. */
+#define WOTS_LEN(n) (2*(n) + 3)
+
+#define PARAMS(f, nn, h, dd) { \
+    .func = (f), .n = (nn), .padding_len = PADDING_LEN(nn), \
+    .wots_w = 16, .wots_log_w = 4, \
+    .wots_len1 = 2*(nn), .wots_len2 = 3, .wots_len = WOTS_LEN(nn), \
+    .wots_sig_bytes = WOTS_LEN(nn) * (nn), \
+    .full_height = (h), .tree_height = (h) / (dd), .d = (dd), \
+    .index_bytes = INDEX_BYTES(h, dd), \
+    .sig_bytes = INDEX_BYTES(h, dd) + (nn) + (dd)*WOTS_LEN(nn)*(nn) \
+                 + (h)*(nn), \
+    .pk_bytes = 2*(nn), .sk_bytes = 0, .bds_k = 0 }
+
+/* The heights of XMSS, in the order of the OIDs. */
+#define XMSS_SETS(name, bits, f, n) \
+    {name "_10_" bits, PARAMS(f, n, 10, 1)}, \
+    {name "_16_" bits, PARAMS(f, n, 16, 1)}, \
+    {name "_20_" bits, PARAMS(f, n, 20, 1)}
+
+/* The heights and layers of XMSS^MT, in the order of the OIDs. */
+#define XMSSMT_SETS(name, bits, f, n) \
+    {name "_20/2_" bits, PARAMS(f, n, 20, 2)}, \
+    {name "_20/4_" bits, PARAMS(f, n, 20, 4)}, \
+    {name "_40/2_" bits, PARAMS(f, n, 40, 2)}, \
+    {name "_40/4_" bits, PARAMS(f, n, 40, 4)}, \
+    {name "_40/8_" bits, PARAMS(f, n, 40, 8)}, \
+    {name "_60/3_" bits, PARAMS(f, n, 60, 3)}, \
+    {name "_60/6_" bits, PARAMS(f, n, 60, 6)}, \
+    {name "_60/12_" bits, PARAMS(f, n, 60, 12)}
+
+typedef struct {
+    const char *name;
+    xmss_params params;
+} param_set;
+
+/* XMSS OIDs 0x00000001 to 0x00000015. */
+static param_set xmss_sets[] = {
+    XMSS_SETS("XMSS-SHA2", "256", XMSS_SHA2, 32),
+    XMSS_SETS("XMSS-SHA2", "512", XMSS_SHA2, 64),
+    XMSS_SETS("XMSS-SHAKE", "256", XMSS_SHAKE128, 32),
+    XMSS_SETS("XMSS-SHAKE", "512", XMSS_SHAKE256, 64),
+    XMSS_SETS("XMSS-SHA2", "192", XMSS_SHA2, 24),
+    XMSS_SETS("XMSS-SHAKE256", "256", XMSS_SHAKE256, 32),
+    XMSS_SETS("XMSS-SHAKE256", "192", XMSS_SHAKE256, 24),
+};
+
+/* XMSS^MT OIDs 0x00000001 to 0x00000038. */
+static param_set xmssmt_sets[] = {
+    XMSSMT_SETS("XMSSMT-SHA2", "256", XMSS_SHA2, 32),
+    XMSSMT_SETS("XMSSMT-SHA2", "512", XMSS_SHA2, 64),
+    XMSSMT_SETS("XMSSMT-SHAKE", "256", XMSS_SHAKE128, 32),
+    XMSSMT_SETS("XMSSMT-SHAKE", "512", XMSS_SHAKE256, 64),
+    XMSSMT_SETS("XMSSMT-SHA2", "192", XMSS_SHA2, 24),
+    XMSSMT_SETS("XMSSMT-SHAKE256", "256", XMSS_SHAKE256, 32),
+    XMSSMT_SETS("XMSSMT-SHAKE256", "192", XMSS_SHAKE256, 24),
+};
+
+#define XMSS_SET_COUNT (sizeof(xmss_sets) / sizeof(xmss_sets[0]))
+#define XMSSMT_SET_COUNT (sizeof(xmssmt_sets) / sizeof(xmssmt_sets[0]))
+
+/* Open addressing on a power of two larger than the number of names. */
+#define NAME_SLOTS 256
+
+/* Entry + 1 of each name, or 0; XMSS^MT entries follow the XMSS ones. */
+static unsigned char name_index[NAME_SLOTS];
+static pthread_once_t registry_once = PTHREAD_ONCE_INIT;
+
+static unsigned int name_hash(const char *s)
 {
-    if (!strcmp(s, "XMSS-SHA2_10_256")) {
-        *oid = 0x00000001;
-    }
-    else if (!strcmp(s, "XMSS-SHA2_16_256")) {
-        *oid = 0x00000002;
-    }
-    else if (!strcmp(s, "XMSS-SHA2_20_256")) {
-        *oid = 0x00000003;
-    }
-    else if (!strcmp(s, "XMSS-SHA2_10_512")) {
-        *oid = 0x00000004;
-    }
-    else if (!strcmp(s, "XMSS-SHA2_16_512")) {
-        *oid = 0x00000005;
-    }
-    else if (!strcmp(s, "XMSS-SHA2_20_512")) {
-        *oid = 0x00000006;
-    }
-    else if (!strcmp(s, "XMSS-SHAKE_10_256")) {
-        *oid = 0x00000007;
-    }
-    else if (!strcmp(s, "XMSS-SHAKE_16_256")) {
-        *oid = 0x00000008;
-    }
-    else if (!strcmp(s, "XMSS-SHAKE_20_256")) {
-        *oid = 0x00000009;
-    }
-    else if (!strcmp(s, "XMSS-SHAKE_10_512")) {
-        *oid = 0x0000000a;
-    }
-    else if (!strcmp(s, "XMSS-SHAKE_16_512")) {
-        *oid = 0x0000000b;
-    }
-    else if (!strcmp(s, "XMSS-SHAKE_20_512")) {
-        *oid = 0x0000000c;
-    }
-    else if (!strcmp(s, "XMSS-SHA2_10_192")) {
-        *oid = 0x0000000d;
-    }
-    else if (!strcmp(s, "XMSS-SHA2_16_192")) {
-        *oid = 0x0000000e;
-    }
-    else if (!strcmp(s, "XMSS-SHA2_20_192")) {
-        *oid = 0x0000000f;
-    }
-    else if (!strcmp(s, "XMSS-SHAKE256_10_256")) {
-        *oid = 0x00000010;
-    }
-    else if (!strcmp(s, "XMSS-SHAKE256_16_256")) {
-        *oid = 0x00000011;
-    }
-    else if (!strcmp(s, "XMSS-SHAKE256_20_256")) {
-        *oid = 0x00000012;
-    }
-    else if (!strcmp(s, "XMSS-SHAKE256_10_192")) {
-        *oid = 0x00000013;
-    }
-    else if (!strcmp(s, "XMSS-SHAKE256_16_192")) {
-        *oid = 0x00000014;
-    }
-    else if (!strcmp(s, "XMSS-SHAKE256_20_192")) {
-        *oid = 0x00000015;
-    }
-    else {
-        return -1;
+    uint32_t h = 2166136261u;
+
+    while (*s) {
+        h = (h ^ (unsigned char)*s++) * 16777619u;
     }
-    return 0;
+    return h & (NAME_SLOTS - 1);
 }
 
-int xmssmt_str_to_oid(uint32_t *oid, const char *s)
+static param_set *set_by_entry(unsigned int entry)
 {
-    if (!strcmp(s, "XMSSMT-SHA2_20/2_256")) {
-        *oid = 0x00000001;
-    }
-    else if (!strcmp(s, "XMSSMT-SHA2_20/4_256")) {
-        *oid = 0x00000002;
-    }
-    else if (!strcmp(s, "XMSSMT-SHA2_40/2_256")) {
-        *oid = 0x00000003;
-    }
-    else if (!strcmp(s, "XMSSMT-SHA2_40/4_256")) {
-        *oid = 0x00000004;
-    }
-    else if (!strcmp(s, "XMSSMT-SHA2_40/8_256")) {
-        *oid = 0x00000005;
-    }
-    else if (!strcmp(s, "XMSSMT-SHA2_60/3_256")) {
-        *oid = 0x00000006;
-    }
-    else if (!strcmp(s, "XMSSMT-SHA2_60/6_256")) {
-        *oid = 0x00000007;
-    }
-    else if (!strcmp(s, "XMSSMT-SHA2_60/12_256")) {
-        *oid = 0x00000008;
-    }
-    else if (!strcmp(s, "XMSSMT-SHA2_20/2_512")) {
-        *oid = 0x00000009;
-    }
-    else if (!strcmp(s, "XMSSMT-SHA2_20/4_512")) {
-        *oid = 0x0000000a;
-    }
-    else if (!strcmp(s, "XMSSMT-SHA2_40/2_512")) {
-        *oid = 0x0000000b;
-    }
-    else if (!strcmp(s, "XMSSMT-SHA2_40/4_512")) {
-        *oid = 0x0000000c;
-    }
-    else if (!strcmp(s, "XMSSMT-SHA2_40/8_512")) {
-        *oid = 0x0000000d;
-    }
-    else if (!strcmp(s, "XMSSMT-SHA2_60/3_512")) {
-        *oid = 0x0000000e;
-    }
-    else if (!strcmp(s, "XMSSMT-SHA2_60/6_512")) {
-        *oid = 0x0000000f;
-    }
-    else if (!strcmp(s, "XMSSMT-SHA2_60/12_512")) {
-        *oid = 0x00000010;
-    }
-    else if (!strcmp(s, "XMSSMT-SHAKE_20/2_256")) {
-        *oid = 0x00000011;
-    }
-    else if (!strcmp(s, "XMSSMT-SHAKE_20/4_256")) {
-        *oid = 0x00000012;
-    }
-    else if (!strcmp(s, "XMSSMT-SHAKE_40/2_256")) {
-        *oid = 0x00000013;
-    }
-    else if (!strcmp(s, "XMSSMT-SHAKE_40/4_256")) {
-        *oid = 0x00000014;
-    }
-    else if (!strcmp(s, "XMSSMT-SHAKE_40/8_256")) {
-        *oid = 0x00000015;
-    }
-    else if (!strcmp(s, "XMSSMT-SHAKE_60/3_256")) {
-        *oid = 0x00000016;
-    }
-    else if (!strcmp(s, "XMSSMT-SHAKE_60/6_256")) {
-        *oid = 0x00000017;
-    }
-    else if (!strcmp(s, "XMSSMT-SHAKE_60/12_256")) {
-        *oid = 0x00000018;
-    }
-    else if (!strcmp(s, "XMSSMT-SHAKE_20/2_512")) {
-        *oid = 0x00000019;
-    }
-    else if (!strcmp(s, "XMSSMT-SHAKE_20/4_512")) {
-        *oid = 0x0000001a;
-    }
-    else if (!strcmp(s, "XMSSMT-SHAKE_40/2_512")) {
-        *oid = 0x0000001b;
-    }
-    else if (!strcmp(s, "XMSSMT-SHAKE_40/4_512")) {
-        *oid = 0x0000001c;
-    }
-    else if (!strcmp(s, "XMSSMT-SHAKE_40/8_512")) {
-        *oid = 0x0000001d;
-    }
-    else if (!strcmp(s, "XMSSMT-SHAKE_60/3_512")) {
-        *oid = 0x0000001e;
-    }
-    else if (!strcmp(s, "XMSSMT-SHAKE_60/6_512")) {
-        *oid = 0x0000001f;
-    }
-    else if (!strcmp(s, "XMSSMT-SHAKE_60/12_512")) {
-        *oid = 0x00000020;
-    }
-    else if (!strcmp(s, "XMSSMT-SHA2_20/2_192")) {
-        *oid = 0x00000021;
-    }
-    else if (!strcmp(s, "XMSSMT-SHA2_20/4_192")) {
-        *oid = 0x00000022;
-    }
-    else if (!strcmp(s, "XMSSMT-SHA2_40/2_192")) {
-        *oid = 0x00000023;
-    }
-    else if (!strcmp(s, "XMSSMT-SHA2_40/4_192")) {
-        *oid = 0x00000024;
-    }
-    else if (!strcmp(s, "XMSSMT-SHA2_40/8_192")) {
-        *oid = 0x00000025;
-    }
-    else if (!strcmp(s, "XMSSMT-SHA2_60/3_192")) {
-        *oid = 0x00000026;
-    }
-    else if (!strcmp(s, "XMSSMT-SHA2_60/6_192")) {
-        *oid = 0x00000027;
-    }
-    else if (!strcmp(s, "XMSSMT-SHA2_60/12_192")) {
-        *oid = 0x00000028;
-    }
-    else if (!strcmp(s, "XMSSMT-SHAKE256_20/2_256")) {
-        *oid = 0x00000029;
-    }
-    else if (!strcmp(s, "XMSSMT-SHAKE256_20/4_256")) {
-        *oid = 0x0000002a;
-    }
-    else if (!strcmp(s, "XMSSMT-SHAKE256_40/2_256")) {
-        *oid = 0x0000002b;
-    }
-    else if (!strcmp(s, "XMSSMT-SHAKE256_40/4_256")) {
-        *oid = 0x0000002c;
-    }
-    else if (!strcmp(s, "XMSSMT-SHAKE256_40/8_256")) {
-        *oid = 0x0000002d;
-    }
-    else if (!strcmp(s, "XMSSMT-SHAKE256_60/3_256")) {
-        *oid = 0x0000002e;
-    }
-    else if (!strcmp(s, "XMSSMT-SHAKE256_60/6_256")) {
-        *oid = 0x0000002f;
-    }
-    else if (!strcmp(s, "XMSSMT-SHAKE256_60/12_256")) {
-        *oid = 0x00000030;
-    }
-    else if (!strcmp(s, "XMSSMT-SHAKE256_20/2_192")) {
-        *oid = 0x00000031;
+    if (entry < XMSS_SET_COUNT) {
+        return xmss_sets + entry;
     }
-    else if (!strcmp(s, "XMSSMT-SHAKE256_20/4_192")) {
-        *oid = 0x00000032;
-    }
-    else if (!strcmp(s, "XMSSMT-SHAKE256_40/2_192")) {
-        *oid = 0x00000033;
-    }
-    else if (!strcmp(s, "XMSSMT-SHAKE256_40/4_192")) {
-        *oid = 0x00000034;
-    }
-    else if (!strcmp(s, "XMSSMT-SHAKE256_40/8_192")) {
-        *oid = 0x00000035;
-    }
-    else if (!strcmp(s, "XMSSMT-SHAKE256_60/3_192")) {
-        *oid = 0x00000036;
-    }
-    else if (!strcmp(s, "XMSSMT-SHAKE256_60/6_192")) {
-        *oid = 0x00000037;
-    }
-    else if (!strcmp(s, "XMSSMT-SHAKE256_60/12_192")) {
-        *oid = 0x00000038;
-    }
-    else {
-        return -1;
-    }
-    return 0;
+    return xmssmt_sets + entry - XMSS_SET_COUNT;
 }
 
-int xmss_parse_oid(xmss_params *params, const uint32_t oid)
+static void registry_init(void)
 {
-    switch (oid) {
-        case 0x00000001:
-        case 0x00000002:
-        case 0x00000003:
-        case 0x00000004:
-        case 0x00000005:
-        case 0x00000006:
-
-        case 0x0000000d:
-        case 0x0000000e:
-        case 0x0000000f:
-            params->func = XMSS_SHA2;
-            break;
-
-        case 0x00000007:
-        case 0x00000008:
-        case 0x00000009:
-            params->func = XMSS_SHAKE128;
-            break;
-
-        case 0x0000000a:
-        case 0x0000000b:
-        case 0x0000000c:
-
-        case 0x00000010:
-        case 0x00000011:
-        case 0x00000012:
-        case 0x00000013:
-        case 0x00000014:
-        case 0x00000015:
-            params->func = XMSS_SHAKE256;
-            break;
-
-        default:
-            return -1;
-    }
-    switch (oid) {
-        case 0x0000000d:
-        case 0x0000000e:
-        case 0x0000000f:
-
-        case 0x00000013:
-        case 0x00000014:
-        case 0x00000015:
-            params->n = 24;
-            params->padding_len = 4;
-            break;
-
-        case 0x00000001:
-        case 0x00000002:
-        case 0x00000003:
-
-        case 0x00000007:
-        case 0x00000008:
-        case 0x00000009:
-
-        case 0x00000010:
-        case 0x00000011:
-        case 0x00000012:
-            params->n = 32;
-            params->padding_len = 32;
-            break;
-
-        case 0x00000004:
-        case 0x00000005:
-        case 0x00000006:
-
-        case 0x0000000a:
-        case 0x0000000b:
-        case 0x0000000c:
-            params->n = 64;
-            params->padding_len = 64;
-            break;
-
-        default:
-            return -1;
-    }
-    switch (oid) {
-        case 0x00000001:
-        case 0x00000004:
-        case 0x00000007:
-        case 0x0000000a:
-        case 0x0000000d:
-        case 0x00000010:
-        case 0x00000013:
-            params->full_height = 10;
-            break;
-
-        case 0x00000002:
-        case 0x00000005:
-        case 0x00000008:
-        case 0x0000000b:
-        case 0x0000000e:
-        case 0x00000011:
-        case 0x00000014:
-            params->full_height = 16;
-            break;
-
-        case 0x00000003:
-        case 0x00000006:
-        case 0x00000009:
-        case 0x0000000c:
-        case 0x0000000f:
-        case 0x00000012:
-        case 0x00000015:
-            params->full_height = 20;
-
-            break;
-        default:
-            return -1;
-    }
+    unsigned int entry;
+    unsigned int slot;
+    param_set *set;
 
-    params->d = 1;
-    params->wots_w = 16;
-
-    // TODO figure out sensible and legal values for this based on the above
-    params->bds_k = 0;
-
-    return xmss_xmssmt_initialize_params(params);
+    for (entry = 0; entry < XMSS_SET_COUNT + XMSSMT_SET_COUNT; entry++) {
+        set = set_by_entry(entry);
+        set->params.sk_bytes = xmss_xmssmt_core_sk_bytes(&set->params);
+        for (slot = name_hash(set->name); name_index[slot];
+             slot = (slot + 1) & (NAME_SLOTS - 1));
+        name_index[slot] = entry + 1;
+    }
 }
 
-int xmssmt_parse_oid(xmss_params *params, const uint32_t oid)
+const xmss_params *xmss_params_lookup(uint32_t oid, int mt)
 {
-    switch (oid) {
-        case 0x00000001:
-        case 0x00000002:
-        case 0x00000003:
-        case 0x00000004:
-        case 0x00000005:
-        case 0x00000006:
-        case 0x00000007:
-        case 0x00000008:
-        case 0x00000009:
-        case 0x0000000a:
-        case 0x0000000b:
-        case 0x0000000c:
-        case 0x0000000d:
-        case 0x0000000e:
-        case 0x0000000f:
-        case 0x00000010:
-
-        case 0x00000021:
-        case 0x00000022:
-        case 0x00000023:
-        case 0x00000024:
-        case 0x00000025:
-        case 0x00000026:
-        case 0x00000027:
-        case 0x00000028:
-            params->func = XMSS_SHA2;
-            break;
-
-        case 0x00000011:
-        case 0x00000012:
-        case 0x00000013:
-        case 0x00000014:
-        case 0x00000015:
-        case 0x00000016:
-        case 0x00000017:
-        case 0x00000018:
-            params->func = XMSS_SHAKE128;
-            break;
-
-        case 0x00000019:
-        case 0x0000001a:
-        case 0x0000001b:
-        case 0x0000001c:
-        case 0x0000001e:
-        case 0x0000001d:
-        case 0x0000001f:
-        case 0x00000020:
-
-        case 0x00000029:
-        case 0x0000002a:
-        case 0x0000002b:
-        case 0x0000002c:
-        case 0x0000002d:
-        case 0x0000002e:
-        case 0x0000002f:
-        case 0x00000030:
-        case 0x00000031:
-        case 0x00000032:
-        case 0x00000033:
-        case 0x00000034:
-        case 0x00000035:
-        case 0x00000036:
-        case 0x00000037:
-        case 0x00000038:
-            params->func = XMSS_SHAKE256;
-            break;
-
-        default:
-            return -1;
+    pthread_once(&registry_once, registry_init);
+    if (mt) {
+        if (oid == 0 || oid > XMSSMT_SET_COUNT) {
+            return NULL;
+        }
+        return &xmssmt_sets[oid - 1].params;
     }
-    switch (oid) {
-        case 0x00000021:
-        case 0x00000022:
-        case 0x00000023:
-        case 0x00000024:
-        case 0x00000025:
-        case 0x00000026:
-        case 0x00000027:
-        case 0x00000028:
-
-        case 0x00000031:
-        case 0x00000032:
-        case 0x00000033:
-        case 0x00000034:
-        case 0x00000035:
-        case 0x00000036:
-        case 0x00000037:
-        case 0x00000038:
-            params->n = 24;
-            params->padding_len = 4;
-            break;
-
-        case 0x00000001:
-        case 0x00000002:
-        case 0x00000003:
-        case 0x00000004:
-        case 0x00000005:
-        case 0x00000006:
-        case 0x00000007:
-        case 0x00000008:
-
-        case 0x00000011:
-        case 0x00000012:
-        case 0x00000013:
-        case 0x00000014:
-        case 0x00000015:
-        case 0x00000016:
-        case 0x00000017:
-        case 0x00000018:
-
-        case 0x00000029:
-        case 0x0000002a:
-        case 0x0000002b:
-        case 0x0000002c:
-        case 0x0000002d:
-        case 0x0000002e:
-        case 0x0000002f:
-        case 0x00000030:
-            params->n = 32;
-            params->padding_len = 32;
-            break;
-
-        case 0x00000009:
-        case 0x0000000a:
-        case 0x0000000b:
-        case 0x0000000c:
-        case 0x0000000d:
-        case 0x0000000e:
-        case 0x0000000f:
-        case 0x00000010:
-
-        case 0x00000019:
-        case 0x0000001a:
-        case 0x0000001b:
-        case 0x0000001c:
-        case 0x0000001d:
-        case 0x0000001e:
-        case 0x0000001f:
-        case 0x00000020:
-            params->n = 64;
-            params->padding_len = 64;
-            break;
-
-        default:
-            return -1;
+    if (oid == 0 || oid > XMSS_SET_COUNT) {
+        return NULL;
     }
-    switch (oid) {
-        case 0x00000001:
-        case 0x00000002:
-
-        case 0x00000009:
-        case 0x0000000a:
-
-        case 0x00000011:
-        case 0x00000012:
-
-        case 0x00000019:
-        case 0x0000001a:
-
-        case 0x00000021:
-        case 0x00000022:
-
-        case 0x00000029:
-        case 0x0000002a:
+    return &xmss_sets[oid - 1].params;
+}
 
-        case 0x00000031:
-        case 0x00000032:
-            params->full_height = 20;
-            break;
+int xmss_params_lookup_name(uint32_t *oid, int *mt, const char *s)
+{
+    unsigned int slot;
+    unsigned int entry;
+
+    pthread_once(&registry_once, registry_init);
+    for (slot = name_hash(s); name_index[slot];
+         slot = (slot + 1) & (NAME_SLOTS - 1)) {
+        entry = name_index[slot] - 1;
+        if (!strcmp(set_by_entry(entry)->name, s)) {
+            *mt = entry >= XMSS_SET_COUNT;
+            *oid = *mt ? entry - XMSS_SET_COUNT + 1 : entry + 1;
+            return 0;
+        }
+    }
+    return -1;
+}
 
-        case 0x00000003:
-        case 0x00000004:
-        case 0x00000005:
+const char *xmss_params_name(uint32_t oid, int mt)
+{
+    if (xmss_params_lookup(oid, mt) == NULL) {
+        return NULL;
+    }
+    return mt ? xmssmt_sets[oid - 1].name : xmss_sets[oid - 1].name;
+}
 
-        case 0x0000000b:
-        case 0x0000000c:
-        case 0x0000000d:
+int xmss_str_to_oid(uint32_t *oid, const char *s)
+{
+    int mt;
 
-        case 0x00000013:
-        case 0x00000014:
-        case 0x00000015:
+    if (xmss_params_lookup_name(oid, &mt, s) || mt) {
+        return -1;
+    }
+    return 0;
+}
 
-        case 0x0000001b:
-        case 0x0000001c:
-        case 0x0000001d:
+int xmssmt_str_to_oid(uint32_t *oid, const char *s)
+{
+    int mt;
 
-        case 0x00000023:
-        case 0x00000024:
-        case 0x00000025:
+    if (xmss_params_lookup_name(oid, &mt, s) || !mt) {
+        return -1;
+    }
+    return 0;
+}
 
-        case 0x0000002b:
-        case 0x0000002c:
-        case 0x0000002d:
+/*
+ * Private-use OIDs encode a custom set in their lower 24 bits: from the most
+ * significant bits down, func (2 bits), the index of n and of wots_w in the
+ * tables below (2 bits each), full_height, d and bds_k (6 bits each).
+ */
+static const unsigned int custom_n[] = {24, 32, 64};
+static const unsigned int custom_w[] = {4, 16, 256};
 
-        case 0x00000033:
-        case 0x00000034:
-        case 0x00000035:
-            params->full_height = 40;
-            break;
+static int custom_index(const unsigned int *values, unsigned int value)
+{
+    int i;
 
-        case 0x00000006:
-        case 0x00000007:
-        case 0x00000008:
+    for (i = 0; i < 3; i++) {
+        if (values[i] == value) {
+            return i;
+        }
+    }
+    return -1;
+}
 
-        case 0x0000000e:
-        case 0x0000000f:
-        case 0x00000010:
+static int parse_private_oid(xmss_params *params, uint32_t oid, int mt)
+{
+    unsigned int n = (oid >> 20) & 3;
+    unsigned int w = (oid >> 18) & 3;
+    unsigned int d = (oid >> 6) & 63;
 
-        case 0x00000016:
-        case 0x00000017:
-        case 0x00000018:
+    if (n > 2 || w > 2 || (mt ? d < 2 : d != 1)) {
+        return -1;
+    }
+    return xmss_params_custom(params, (oid >> 22) & 3, custom_n[n],
+                              (oid >> 12) & 63, d, custom_w[w], oid & 63);
+}
 
-        case 0x0000001e:
-        case 0x0000001f:
-        case 0x00000020:
+int xmss_parse_oid(xmss_params *params, const uint32_t oid)
+{
+    const xmss_params *p = xmss_params_lookup(oid, 0);
 
-        case 0x00000026:
-        case 0x00000027:
-        case 0x00000028:
+    if (p == NULL) {
+        if ((oid & 0xff000000) == XMSS_OID_PRIVATE) {
+            return parse_private_oid(params, oid, 0);
+        }
+        return -1;
+    }
+    *params = *p;
+    return 0;
+}
 
-        case 0x0000002e:
-        case 0x0000002f:
-        case 0x00000030:
+int xmssmt_parse_oid(xmss_params *params, const uint32_t oid)
+{
+    const xmss_params *p = xmss_params_lookup(oid, 1);
 
-        case 0x00000036:
-        case 0x00000037:
-        case 0x00000038:
-            params->full_height = 60;
-            break;
+    if (p == NULL) {
+        if ((oid & 0xff000000) == XMSS_OID_PRIVATE) {
+            return parse_private_oid(params, oid, 1);
+        }
+        return -1;
+    }
+    *params = *p;
+    return 0;
+}
 
-        default:
-            return -1;
+int xmss_params_custom(xmss_params *params, unsigned int func, unsigned int n,
+                       unsigned int full_height, unsigned int d,
+                       unsigned int wots_w, unsigned int bds_k)
+{
+    /* The combinations of hash function and n that core_hash supports. */
+    if (!(n == 24 && (func == XMSS_SHA2 || func == XMSS_SHAKE256)) &&
+        !(n == 32 && func <= XMSS_SHAKE256) &&
+        !(n == 64 && (func == XMSS_SHA2 || func == XMSS_SHAKE256))) {
+        return -1;
     }
-    switch (oid) {
-        case 0x00000001:
-        case 0x00000003:
-        case 0x00000009:
-        case 0x0000000b:
-        case 0x00000011:
-        case 0x00000013:
-        case 0x00000019:
-        case 0x0000001b:
-        case 0x00000021:
-        case 0x00000023:
-        case 0x00000029:
-        case 0x0000002b:
-        case 0x00000031:
-        case 0x00000033:
-            params->d = 2;
-            break;
-
-        case 0x00000002:
-        case 0x00000004:
-        case 0x0000000a:
-        case 0x0000000c:
-        case 0x00000012:
-        case 0x00000014:
-        case 0x0000001a:
-        case 0x0000001c:
-        case 0x00000022:
-        case 0x00000024:
-        case 0x0000002a:
-        case 0x0000002c:
-        case 0x00000032:
-        case 0x00000034:
-            params->d = 4;
-            break;
-
-        case 0x00000005:
-        case 0x0000000d:
-        case 0x00000015:
-        case 0x0000001d:
-        case 0x00000025:
-        case 0x0000002d:
-        case 0x00000035:
-            params->d = 8;
-            break;
-
-        case 0x00000006:
-        case 0x0000000e:
-        case 0x00000016:
-        case 0x0000001e:
-        case 0x00000026:
-        case 0x0000002e:
-        case 0x00000036:
-            params->d = 3;
-            break;
-
-        case 0x00000007:
-        case 0x0000000f:
-        case 0x00000017:
-        case 0x0000001f:
-        case 0x00000027:
-        case 0x0000002f:
-        case 0x00000037:
-            params->d = 6;
-            break;
-
-        case 0x00000008:
-        case 0x00000010:
-        case 0x00000018:
-        case 0x00000020:
-        case 0x00000028:
-        case 0x00000030:
-        case 0x00000038:
-            params->d = 12;
-            break;
-
-        default:
-            return -1;
+    /* Leaf indices within a tree are uint32_t, and XMSS has a 4-byte
+       index. */
+    if (d == 0 || full_height == 0 || full_height > 63 ||
+        full_height % d || full_height / d > 31 ||
+        (d == 1 && full_height > 32) || bds_k > full_height / d) {
+        return -1;
     }
+    memset(params, 0, sizeof(xmss_params));
+    params->func = func;
+    params->n = n;
+    params->padding_len = PADDING_LEN(n);
+    params->full_height = full_height;
+    params->d = d;
+    params->wots_w = wots_w;
+    params->bds_k = bds_k;
+    if (xmss_xmssmt_initialize_params(params)) {
+        return -1;
+    }
+    /* The BDS treehash instances need h - k to be even. */
+    if ((bds_k > 0 ||
+         params->sk_bytes != params->index_bytes + 4*params->n) &&
+        (params->tree_height - bds_k) % 2) {
+        return -1;
+    }
+    return 0;
+}
 
-    params->wots_w = 16;
-
-    // TODO figure out sensible and legal values for this based on the above
-    params->bds_k = 0;
+int xmss_params_to_oid(uint32_t *oid, const xmss_params *params)
+{
+    int n = custom_index(custom_n, params->n);
+    int w = custom_index(custom_w, params->wots_w);
 
-    return xmss_xmssmt_initialize_params(params);
+    if (n < 0 || w < 0 || params->full_height > 63 || params->d > 63 ||
+        params->bds_k > 63) {
+        return -1;
+    }
+    *oid = XMSS_OID_PRIVATE | params->func << 22 | (unsigned int)n << 20 |
+           (unsigned int)w << 18 | params->full_height << 12 |
+           params->d << 6 | params->bds_k;
+    return 0;
 }
 
 /**
@@ -11,6 +11,9 @@
 /* This is a result of the OID definitions in the draft; needed for parsing. */
 #define XMSS_OID_LEN 4
 
+/* OIDs from this value on are for private use (RFC 8391, section 9). */
+#define XMSS_OID_PRIVATE 0xdd000000
+
 /* This structure will be populated when calling xmss[mt]_parse_oid. */
 typedef struct {
     unsigned int func;
@@ -32,6 +35,25 @@ typedef struct {
     unsigned int bds_k;
 } xmss_params;
 
+/**
+ * Returns the parameters of an XMSS (mt = 0) or XMSS^MT (mt = 1) OID from
+ * the static registry of parameter sets, or NULL if the OID is unknown.
+ * All parameters are derived in advance, so this is a single indexed load.
+ * The result must not be modified.
+ */
+const xmss_params *xmss_params_lookup(uint32_t oid, int mt);
+
+/**
+ * Looks up a parameter set by its name, such as "XMSS-SHA2_10_256" or
+ * "XMSSMT-SHA2_20/2_256", through a hash index. Sets oid, and sets mt to
+ * 1 for XMSS^MT and to 0 for XMSS.
+ * Returns -1 when the name is not found, 0 otherwise.
+ */
+int xmss_params_lookup_name(uint32_t *oid, int *mt, const char *s);
+
+/* Returns the name of an XMSS or XMSS^MT OID, or NULL if it is unknown. */
+const char *xmss_params_name(uint32_t oid, int mt);
+
 /**
  * Accepts strings such as "XMSS-SHA2_10_256"
  *  and outputs OIDs such as 0x01000001.
@@ -48,12 +70,16 @@ int xmssmt_str_to_oid(uint32_t *oid, const char *s);
 
 /**
  * Accepts OIDs such as 0x01000001, and configures params accordingly.
+ * Private-use OIDs that xmss_params_to_oid created for an XMSS set are
+ * accepted as well.
  * Returns -1 when the OID is not found, 0 otherwise.
  */
 int xmss_parse_oid(xmss_params *params, const uint32_t oid);
 
 /**
  * Accepts OIDs such as 0x01000001, and configures params accordingly.
+ * Private-use OIDs that xmss_params_to_oid created for an XMSS^MT set are
+ * accepted as well.
  * Returns -1 when the OID is not found, 0 otherwise.
  */
 int xmssmt_parse_oid(xmss_params *params, const uint32_t oid);
@@ -69,4 +95,25 @@ int xmssmt_parse_oid(xmss_params *params, const uint32_t oid);
     this function initializes the remainder of the params structure. */
 int xmss_xmssmt_initialize_params(xmss_params *params);
 
+/**
+ * Initializes params for a custom set: hash function func with n-byte
+ * outputs, a hypertree of d layers and height full_height, Winternitz
+ * parameter wots_w (4, 16 or 256) and BDS parameter bds_k.
+ * Returns -1 when the combination is not supported, 0 otherwise. Trees are
+ * at most 31 levels high, which also keeps the 4-byte index of XMSS in
+ * range. With BDS state, i.e. bds_k > 0 or a core that keeps it in the key,
+ * tree_height - bds_k has to be even.
+ */
+int xmss_params_custom(xmss_params *params, unsigned int func, unsigned int n,
+                       unsigned int full_height, unsigned int d,
+                       unsigned int wots_w, unsigned int bds_k);
+
+/**
+ * Outputs the private-use OID that encodes a set made by xmss_params_custom,
+ * for XMSS when d is 1 and for XMSS^MT otherwise. xmss[mt]_parse_oid turns
+ * it back into the same params, so keys made with it work with all tools.
+ * Returns -1 when the set cannot be encoded, 0 otherwise.
+ */
+int xmss_params_to_oid(uint32_t *oid, const xmss_params *params);
+
 #endif
@@ -2,39 +2,208 @@
 This code was taken from the SPHINCS reference implementation and is public domain.
 */
 
+#include <errno.h>
 #include <fcntl.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
 #include <unistd.h>
+#include <sys/random.h>
 
-static int fd = -1;
+#include "fips202.h"
+#include "randombytes.h"
 
-void randombytes(unsigned char *x, unsigned long long xlen)
+/* The key size of the generator, and the number of requests and of bytes
+   after which it is reseeded from the entropy source. */
+#define DRBG_KEY_BYTES 64
+/* Output is generated ahead, four SHAKE256 blocks at a time, including the
+   next key. */
+#define DRBG_BUFFER_BYTES (4 * SHAKE256_RATE - DRBG_KEY_BYTES)
+#define DRBG_RESEED_REQUESTS 4096
+#define DRBG_RESEED_BYTES (1ULL << 20)
+
+/* The state of the generator of a thread. */
+typedef struct {
+    unsigned char key[DRBG_KEY_BYTES];
+    /* The output that has not been used yet is at the end of the buffer;
+       used output is erased. */
+    unsigned char buffer[DRBG_BUFFER_BYTES];
+    unsigned int available;
+    unsigned long long counter;
+    unsigned long long requests;
+    unsigned long long bytes;
+    /* The value of 'generation' when the generator was last seeded. */
+    unsigned long generation;
+    int seeded;
+} drbg_state;
+
+static __thread drbg_state drbg;
+
+static randombytes_source source;
+static void *source_arg;
+/* Forces every thread to reseed when it changes, i.e. when the source is
+   replaced, or in the child after a fork. */
+static unsigned long generation;
+static pthread_mutex_t source_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_once_t atfork_once = PTHREAD_ONCE_INIT;
+
+static void new_generation(void)
 {
-    int i;
+    __atomic_add_fetch(&generation, 1, __ATOMIC_RELEASE);
+}
 
+/* A forked child must not repeat the output of its parent. */
+static void register_atfork(void)
+{
+    pthread_atfork(NULL, NULL, new_generation);
+}
+
+/* Reads from /dev/urandom, for kernels without getrandom. */
+static int read_urandom(unsigned char *x, unsigned long long xlen)
+{
+    int fd;
+    ssize_t i;
+
+    fd = open("/dev/urandom", O_RDONLY | O_CLOEXEC);
     if (fd == -1) {
-        for (;;) {
-            fd = open("/dev/urandom", O_RDONLY);
-            if (fd != -1) {
-                break;
+        return -1;
+    }
+    while (xlen > 0) {
+        i = read(fd, x, xlen < 1048576 ? xlen : 1048576);
+        if (i < 1) {
+            if (i == -1 && errno == EINTR) {
+                continue;
             }
-            sleep(1);
+            close(fd);
+            return -1;
         }
+        x += i;
+        xlen -= i;
     }
+    close(fd);
+    return 0;
+}
 
-    while (xlen > 0) {
-        if (xlen < 1048576) {
-            i = xlen;
-        }
-        else {
-            i = 1048576;
-        }
+int randombytes_os(void *arg, unsigned char *x, unsigned long long xlen)
+{
+    ssize_t i;
 
-        i = read(fd, x, i);
+    (void)arg;
+    while (xlen > 0) {
+        /* Requests of up to 256 bytes are never cut short. */
+        i = getrandom(x, xlen < 256 ? xlen : 256, 0);
         if (i < 1) {
-            sleep(1);
-            continue;
+            if (i == -1 && errno == EINTR) {
+                continue;
+            }
+            if (i == -1 && errno == ENOSYS) {
+                return read_urandom(x, xlen);
+            }
+            return -1;
         }
+        x += i;
+        xlen -= i;
+    }
+    return 0;
+}
+
+void randombytes_set_source(randombytes_source fn, void *arg)
+{
+    pthread_mutex_lock(&source_lock);
+    source = fn;
+    source_arg = arg;
+    new_generation();
+    pthread_mutex_unlock(&source_lock);
+}
+
+/* Mixes fresh entropy into the key of the generator of this thread. */
+static void drbg_reseed(unsigned long current)
+{
+    unsigned char entropy[DRBG_KEY_BYTES];
+    shake_ctx state;
+    int ret;
+
+    pthread_mutex_lock(&source_lock);
+    ret = source != NULL ? source(source_arg, entropy, sizeof(entropy))
+                         : randombytes_os(NULL, entropy, sizeof(entropy));
+    pthread_mutex_unlock(&source_lock);
+    /* There is no safe way to continue without entropy: keys would be
+       predictable. */
+    if (ret) {
+        abort();
+    }
+
+    /* A new generation starts over, so that its output depends on the
+       source alone; this makes the output of a replayed source repeat. */
+    if (drbg.generation != current) {
+        memset(&drbg, 0, sizeof(drbg));
+    }
+    shake256_inc_init(&state);
+    shake_inc_absorb(&state, drbg.key, sizeof(drbg.key));
+    shake_inc_absorb(&state, entropy, sizeof(entropy));
+    shake_inc_finalize(&state);
+    shake_inc_squeeze(drbg.key, sizeof(drbg.key), &state);
 
+    memset(entropy, 0, sizeof(entropy));
+    memset(&state, 0, sizeof(state));
+    memset(drbg.buffer, 0, sizeof(drbg.buffer));
+    drbg.available = 0;
+    drbg.requests = 0;
+    drbg.bytes = 0;
+    drbg.generation = current;
+    drbg.seeded = 1;
+}
+
+/* Generates the next buffer of output, and replaces the key. */
+static void drbg_refill(void)
+{
+    unsigned char counter[8];
+    shake_ctx state;
+    int i;
+
+    /* The output is SHAKE256(key || counter); its first bytes replace the
+       key, so that earlier output cannot be recomputed from the state. */
+    for (i = 0; i < 8; i++) {
+        counter[i] = (unsigned char)(drbg.counter >> (8 * i));
+    }
+    drbg.counter++;
+
+    shake256_inc_init(&state);
+    shake_inc_absorb(&state, drbg.key, sizeof(drbg.key));
+    shake_inc_absorb(&state, counter, sizeof(counter));
+    shake_inc_finalize(&state);
+    shake_inc_squeeze(drbg.key, sizeof(drbg.key), &state);
+    shake_inc_squeeze(drbg.buffer, sizeof(drbg.buffer), &state);
+    memset(&state, 0, sizeof(state));
+    drbg.available = sizeof(drbg.buffer);
+}
+
+void randombytes(unsigned char *x, unsigned long long xlen)
+{
+    unsigned long current;
+    unsigned char *out;
+    unsigned int i;
+
+    pthread_once(&atfork_once, register_atfork);
+
+    current = __atomic_load_n(&generation, __ATOMIC_ACQUIRE);
+    if (!drbg.seeded || drbg.generation != current ||
+        drbg.requests >= DRBG_RESEED_REQUESTS ||
+        drbg.bytes >= DRBG_RESEED_BYTES) {
+        drbg_reseed(current);
+    }
+    drbg.requests++;
+    drbg.bytes += xlen;
+
+    while (xlen > 0) {
+        if (drbg.available == 0) {
+            drbg_refill();
+        }
+        i = xlen < drbg.available ? xlen : drbg.available;
+        out = drbg.buffer + sizeof(drbg.buffer) - drbg.available;
+        memcpy(x, out, i);
+        memset(out, 0, i);
+        drbg.available -= i;
         x += i;
         xlen -= i;
     }
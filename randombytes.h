@@ -2,8 +2,34 @@
 #define XMSS_RANDOMBYTES_H
 
 /**
- * Tries to read xlen bytes from a source of randomness, and writes them to x.
+ * A source of entropy: writes xlen random bytes to x, and returns 0, or
+ * returns -1 on failure.
+ */
+typedef int (*randombytes_source)(void *arg,
+                                  unsigned char *x, unsigned long long xlen);
+
+/**
+ * Writes xlen random bytes to x. The bytes come from a SHAKE256-based
+ * generator of the calling thread, which is seeded from the entropy source
+ * on its first use, and reseeded after 4096 calls or 1 MiB of output, after
+ * the source is replaced, and in the child after a fork. Only reseeding
+ * makes a system call. Aborts when the source fails, as there is no safe
+ * way to continue.
  */
 void randombytes(unsigned char *x, unsigned long long xlen);
 
+/**
+ * The default entropy source: the getrandom system call, or /dev/urandom
+ * on kernels without it. arg is ignored.
+ */
+int randombytes_os(void *arg, unsigned char *x, unsigned long long xlen);
+
+/**
+ * Replaces the entropy source by fn, which is called with arg; NULL
+ * restores randombytes_os. Every thread reseeds its generator from the new
+ * source on its next call of randombytes. Calls of the source are
+ * serialized, and must not call randombytes.
+ */
+void randombytes_set_source(randombytes_source fn, void *arg);
+
 #endif
@@ -0,0 +1,156 @@
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "../hash.h"
+#include "../params.h"
+#include "../randombytes.h"
+#include "../xmss_core.h"
+#include "../xmss_batch.h"
+
+#define MLEN 32
+#define COUNT 5
+
+static int is_zero(const unsigned char *buf, unsigned long long len)
+{
+    unsigned long long i;
+
+    for (i = 0; i < len; i++) {
+        if (buf[i]) {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+/**
+ * Signs a batch of one message, whose root is the message hash of its leaf,
+ * and checks that the shared signature opens on the tagged root only.
+ */
+static int test_tag(const xmss_params *params)
+{
+    unsigned long long sig_len = xmss_batch_sig_bytes(params, 0);
+    unsigned long long offset = params->sig_bytes + XMSS_BATCH_TAG_BYTES;
+    unsigned char pk[params->pk_bytes];
+    unsigned char sk[params->sk_bytes];
+    unsigned char m[MLEN];
+    const unsigned char *ms[1] = {m};
+    unsigned long long mlens[1] = {MLEN};
+    unsigned char sig[sig_len];
+    unsigned char sm[offset + params->n];
+    unsigned char mout[offset + params->n];
+    unsigned long long mlen;
+    xmss_hash_msg_ctx hash;
+
+    xmssmt_core_keypair(params, pk, sk);
+    randombytes(m, MLEN);
+    if (xmssmt_core_batch_sign(params, sk, sig, ms, mlens, 1)) {
+        return -1;
+    }
+
+    memcpy(sm, sig, params->sig_bytes);
+    memcpy(sm + params->sig_bytes, XMSS_BATCH_TAG, XMSS_BATCH_TAG_BYTES);
+    if (hash_message_init(params, &hash, sig + params->index_bytes, pk, 0)) {
+        return -1;
+    }
+    if (hash_message_update(params, &hash, m, MLEN)) {
+        hash_message_final(params, &hash, sm + offset);
+        return -1;
+    }
+    if (hash_message_final(params, &hash, sm + offset)) {
+        return -1;
+    }
+    if (xmssmt_core_sign_open(params, mout, &mlen, sm, offset + params->n,
+                              pk)) {
+        return -1;
+    }
+    memmove(sm + params->sig_bytes, sm + offset, params->n);
+    if (!xmssmt_core_sign_open(params, mout, &mlen, sm,
+                               params->sig_bytes + params->n, pk)) {
+        return -1;
+    }
+    return 0;
+}
+
+/**
+ * Signs a batch and checks that every signature verifies on its own message
+ * only, and that a flipped bit in its shared part or in its path does not.
+ * Once the key is used up, a batch is refused without writing signatures.
+ */
+static int test_params(const xmss_params *params)
+{
+    unsigned int height = xmss_batch_height(COUNT);
+    unsigned long long sig_len = xmss_batch_sig_bytes(params, height);
+    unsigned char pk[params->pk_bytes];
+    unsigned char sk[params->sk_bytes];
+    unsigned char m[COUNT][MLEN];
+    const unsigned char *ms[COUNT];
+    unsigned long long mlens[COUNT];
+    unsigned char *sigs;
+    unsigned char *sig;
+    unsigned int i;
+    int ret = -1;
+
+    sigs = calloc(COUNT, sig_len);
+    if (sigs == NULL) {
+        return -1;
+    }
+
+    xmssmt_core_keypair(params, pk, sk);
+    for (i = 0; i < COUNT; i++) {
+        randombytes(m[i], MLEN);
+        ms[i] = m[i];
+        mlens[i] = MLEN;
+    }
+    if (xmssmt_core_batch_sign(params, sk, sigs, ms, mlens, COUNT)) {
+        goto out;
+    }
+
+    for (i = 0; i < COUNT; i++) {
+        sig = sigs + i*sig_len;
+        if (xmssmt_core_batch_verify(params, sig, sig_len, m[i], MLEN, pk)) {
+            goto out;
+        }
+        if (!xmssmt_core_batch_verify(params, sig, sig_len,
+                                      m[(i + 1) % COUNT], MLEN, pk)) {
+            goto out;
+        }
+        sig[params->index_bytes + params->n] ^= 1;
+        if (!xmssmt_core_batch_verify(params, sig, sig_len, m[i], MLEN, pk)) {
+            goto out;
+        }
+        sig[params->index_bytes + params->n] ^= 1;
+        sig[sig_len - 1] ^= 1;
+        if (!xmssmt_core_batch_verify(params, sig, sig_len, m[i], MLEN, pk)) {
+            goto out;
+        }
+        sig[sig_len - 1] ^= 1;
+    }
+
+    /* A used-up key has an index of all ones. */
+    memset(sigs, 0, COUNT * sig_len);
+    memset(sk, 0xFF, params->index_bytes);
+    if (!xmssmt_core_batch_sign(params, sk, sigs, ms, mlens, COUNT) ||
+        !is_zero(sigs, COUNT * sig_len)) {
+        goto out;
+    }
+    ret = 0;
+out:
+    free(sigs);
+    return ret;
+}
+
+int main()
+{
+    xmss_params params;
+
+    printf("Testing Merkle-batched XMSSMT signatures.. ");
+    if (xmss_params_custom(&params, XMSS_SHA2, 32, 4, 2, 16, 0) ||
+        test_params(&params) || test_tag(&params)) {
+        printf("failed!\n");
+        return -1;
+    }
+    printf("successful.\n");
+    return 0;
+}
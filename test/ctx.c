@@ -0,0 +1,113 @@
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "../params.h"
+#include "../randombytes.h"
+#include "../xmss_core.h"
+#include "../xmss_ctx.h"
+
+#define MLEN 32
+#define SIGNATURES 3
+
+/* The seeds of both keypairs are drawn from this fixed sequence. */
+static unsigned char seed_byte;
+
+static void fixed_randombytes(unsigned char *x, unsigned long long xlen)
+{
+    while (xlen-- > 0) {
+        *x++ = seed_byte++;
+    }
+}
+
+static int test_oid(uint32_t oid, int mt)
+{
+    xmss_params params;
+    xmss_ctx ctx;
+    unsigned int i;
+    int ret = -1;
+
+    if (mt) {
+        xmssmt_parse_oid(&params, oid);
+    }
+    else {
+        xmss_parse_oid(&params, oid);
+    }
+
+    unsigned char seed[3 * params.n];
+    unsigned char pk1[params.pk_bytes];
+    unsigned char pk2[params.pk_bytes];
+    unsigned char sk1[params.sk_bytes];
+    unsigned char sk2[params.sk_bytes];
+    unsigned char m[MLEN];
+    unsigned char m2[params.sig_bytes + MLEN];
+    unsigned char sm1[params.sig_bytes + MLEN];
+    unsigned char sm2[params.sig_bytes + MLEN];
+    unsigned long long smlen1;
+    unsigned long long smlen2;
+    unsigned long long mlen;
+
+    if (xmss_ctx_init(&ctx, &params)) {
+        return -1;
+    }
+    ctx.randombytes = fixed_randombytes;
+
+    seed_byte = 0;
+    fixed_randombytes(seed, 3 * params.n);
+    xmssmt_core_seed_keypair(&params, pk1, sk1, seed);
+    seed_byte = 0;
+    if (xmss_ctx_keypair(&ctx, pk2, sk2) ||
+        memcmp(pk1, pk2, params.pk_bytes) ||
+        memcmp(sk1, sk2, params.sk_bytes)) {
+        goto out;
+    }
+
+    for (i = 0; i < SIGNATURES; i++) {
+        randombytes(m, MLEN);
+        xmssmt_core_sign(&params, sk1, sm1, &smlen1, m, MLEN);
+        if (xmss_ctx_sign(&ctx, sk2, sm2, &smlen2, m, MLEN) ||
+            smlen1 != smlen2 || memcmp(sm1, sm2, smlen1) ||
+            memcmp(sk1, sk2, params.sk_bytes)) {
+            goto out;
+        }
+        if (xmss_ctx_open(&ctx, m2, &mlen, sm2, smlen2, pk2) ||
+            mlen != MLEN || memcmp(m, m2, MLEN)) {
+            goto out;
+        }
+
+        /* A signature with a flipped bit does not verify. */
+        sm2[params.index_bytes + params.n] ^= 1;
+        if (!xmss_ctx_open(&ctx, m2, &mlen, sm2, smlen2, pk2)) {
+            goto out;
+        }
+    }
+    ret = 0;
+out:
+    xmss_ctx_free(&ctx);
+    return ret;
+}
+
+int main()
+{
+    /* One XMSS OID for each combination of hash function and n. */
+    uint32_t oids[] = {0x00000001, 0x00000004, 0x0000000d, 0x00000007,
+                       0x0000000a, 0x00000010, 0x00000013};
+    unsigned int i;
+
+    printf("Testing XMSS signing with a context.. ");
+    for (i = 0; i < sizeof(oids) / sizeof(oids[0]); i++) {
+        if (test_oid(oids[i], 0)) {
+            printf("failed for OID %u!\n", oids[i]);
+            return -1;
+        }
+    }
+    printf("successful.\n");
+
+    printf("Testing XMSSMT signing with a context.. ");
+    if (test_oid(0x00000002, 1)) {
+        printf("failed!\n");
+        return -1;
+    }
+    printf("successful.\n");
+    return 0;
+}
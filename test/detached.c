@@ -0,0 +1,87 @@
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "../params.h"
+#include "../randombytes.h"
+#include "../xmss_core.h"
+#include "../xmss_detached.h"
+
+#define MLEN 32
+#define SIGNATURES 3
+
+static int test_oid(uint32_t oid, int mt)
+{
+    xmss_params params;
+    unsigned int i;
+
+    if (mt) {
+        xmssmt_parse_oid(&params, oid);
+    }
+    else {
+        xmss_parse_oid(&params, oid);
+    }
+
+    unsigned char pk[params.pk_bytes];
+    unsigned char sk1[params.sk_bytes];
+    unsigned char sk2[params.sk_bytes];
+    unsigned char m[MLEN];
+    unsigned char sig[params.sig_bytes];
+    unsigned char sm[params.sig_bytes + MLEN];
+    unsigned long long smlen;
+
+    xmssmt_core_keypair(&params, pk, sk1);
+    memcpy(sk2, sk1, params.sk_bytes);
+
+    for (i = 0; i < SIGNATURES; i++) {
+        randombytes(m, MLEN);
+        xmssmt_core_sign(&params, sk1, sm, &smlen, m, MLEN);
+        if (xmssmt_core_sign_detached(&params, sk2, sig, m, MLEN) ||
+            memcmp(sm, sig, params.sig_bytes) ||
+            memcmp(sk1, sk2, params.sk_bytes)) {
+            return -1;
+        }
+        if (xmssmt_core_verify_detached(&params, sig, m, MLEN, pk)) {
+            return -1;
+        }
+
+        /* Neither a flipped bit in the message nor in the signature
+           verifies. */
+        m[0] ^= 1;
+        if (!xmssmt_core_verify_detached(&params, sig, m, MLEN, pk)) {
+            return -1;
+        }
+        m[0] ^= 1;
+        sig[params.index_bytes + params.n] ^= 1;
+        if (!xmssmt_core_verify_detached(&params, sig, m, MLEN, pk)) {
+            return -1;
+        }
+    }
+
+    /* A key of the BDS core is longer than index and seeds; it is refused
+       and left unchanged. */
+    params.sk_bytes++;
+    if (!xmssmt_core_sign_detached(&params, sk2, sig, m, MLEN) ||
+        memcmp(sk1, sk2, params.sk_bytes - 1)) {
+        return -1;
+    }
+    return 0;
+}
+
+int main()
+{
+    printf("Testing detached XMSS signatures.. ");
+    if (test_oid(0x00000001, 0)) {
+        printf("failed!\n");
+        return -1;
+    }
+    printf("successful.\n");
+
+    printf("Testing detached XMSSMT signatures.. ");
+    if (test_oid(0x00000002, 1)) {
+        printf("failed!\n");
+        return -1;
+    }
+    printf("successful.\n");
+    return 0;
+}
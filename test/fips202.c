@@ -0,0 +1,71 @@
+#include <stdio.h>
+#include <string.h>
+
+#include "../fips202.h"
+#include "../randombytes.h"
+
+#define INLEN 1000
+/* Longer than the rate of both functions, so that squeezing permutes. */
+#define OUTLEN 600
+
+/**
+ * Compares incremental SHAKE to the one-shot function, absorbing and
+ * squeezing in parts of 'part' bytes, and continuing from a clone of the
+ * state after every part of the input.
+ */
+static int test_shake(void (*shake)(unsigned char *, unsigned long long,
+                                    const unsigned char *, unsigned long long),
+                      void (*inc_init)(shake_ctx *),
+                      unsigned long long part)
+{
+    unsigned char in[INLEN];
+    unsigned char out1[OUTLEN];
+    unsigned char out2[OUTLEN];
+    shake_ctx ctx;
+    shake_ctx clone;
+    unsigned long long offset;
+    unsigned long long len;
+
+    randombytes(in, INLEN);
+
+    inc_init(&ctx);
+    for (offset = 0; offset < INLEN; offset += len) {
+        len = INLEN - offset < part ? INLEN - offset : part;
+        shake_inc_absorb(&ctx, in + offset, len);
+
+        /* A clone finishes the prefix absorbed so far. */
+        shake_inc_clone(&clone, &ctx);
+        shake_inc_finalize(&clone);
+        shake_inc_squeeze(out2, OUTLEN, &clone);
+        shake(out1, OUTLEN, in, offset + len);
+        if (memcmp(out1, out2, OUTLEN)) {
+            return -1;
+        }
+    }
+    shake_inc_finalize(&ctx);
+    for (offset = 0; offset < OUTLEN; offset += len) {
+        len = OUTLEN - offset < part ? OUTLEN - offset : part;
+        shake_inc_squeeze(out2 + offset, len, &ctx);
+    }
+    shake(out1, OUTLEN, in, INLEN);
+    return memcmp(out1, out2, OUTLEN) ? -1 : 0;
+}
+
+int main()
+{
+    /* Parts around the rates of SHAKE128 (168) and SHAKE256 (136). */
+    unsigned long long parts[] = {1, 7, 135, 136, 137, 168, 169, 500, INLEN};
+    unsigned int i;
+
+    printf("Testing incremental SHAKE128 and SHAKE256.. ");
+
+    for (i = 0; i < sizeof(parts) / sizeof(parts[0]); i++) {
+        if (test_shake(shake128, shake128_inc_init, parts[i]) ||
+            test_shake(shake256, shake256_inc_init, parts[i])) {
+            printf("failed!\n");
+            return -1;
+        }
+    }
+    printf("successful.\n");
+    return 0;
+}
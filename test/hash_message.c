@@ -0,0 +1,69 @@
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "../hash.h"
+#include "../params.h"
+#include "../randombytes.h"
+
+#define MLEN 1000
+
+/* Compares the incremental message hash to hash_message for one OID. */
+static int test_oid(uint32_t oid)
+{
+    xmss_params params;
+    xmss_hash_msg_ctx ctx;
+    unsigned int parts[] = {1, 7, 64, 200, MLEN};
+    unsigned int i;
+    unsigned long long offset;
+    unsigned long long len;
+
+    xmss_parse_oid(&params, oid);
+
+    unsigned char R[params.n];
+    unsigned char root[params.n];
+    unsigned char m[MLEN];
+    unsigned char m_with_prefix[params.padding_len + 3*params.n + MLEN];
+    unsigned char out1[params.n];
+    unsigned char out2[params.n];
+
+    randombytes(R, params.n);
+    randombytes(root, params.n);
+    randombytes(m, MLEN);
+
+    memcpy(m_with_prefix + params.padding_len + 3*params.n, m, MLEN);
+    hash_message(&params, out1, R, root, 42, m_with_prefix, MLEN);
+
+    for (i = 0; i < sizeof(parts) / sizeof(parts[0]); i++) {
+        hash_message_init(&params, &ctx, R, root, 42);
+        for (offset = 0; offset < MLEN; offset += len) {
+            len = MLEN - offset < parts[i] ? MLEN - offset : parts[i];
+            hash_message_update(&params, &ctx, m + offset, len);
+        }
+        hash_message_final(&params, &ctx, out2);
+        if (memcmp(out1, out2, params.n)) {
+            return -1;
+        }
+    }
+    return 0;
+}
+
+int main()
+{
+    /* One OID for each combination of hash function and n. */
+    uint32_t oids[] = {0x00000001, 0x00000004, 0x0000000d, 0x00000007,
+                       0x0000000a, 0x00000010, 0x00000013};
+    unsigned int i;
+
+    printf("Testing incremental message hash.. ");
+
+    for (i = 0; i < sizeof(oids) / sizeof(oids[0]); i++) {
+        if (test_oid(oids[i])) {
+            printf("failed for OID %x!\n", oids[i]);
+            return -1;
+        }
+    }
+    printf("successful.\n");
+
+    return 0;
+}
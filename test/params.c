@@ -0,0 +1,171 @@
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "../params.h"
+
+#define XMSS_OIDS 21
+#define XMSSMT_OIDS 56
+
+static int same_params(const xmss_params *a, const xmss_params *b)
+{
+    return a->func == b->func && a->n == b->n &&
+           a->padding_len == b->padding_len && a->wots_w == b->wots_w &&
+           a->wots_log_w == b->wots_log_w && a->wots_len1 == b->wots_len1 &&
+           a->wots_len2 == b->wots_len2 && a->wots_len == b->wots_len &&
+           a->wots_sig_bytes == b->wots_sig_bytes &&
+           a->full_height == b->full_height &&
+           a->tree_height == b->tree_height && a->d == b->d &&
+           a->index_bytes == b->index_bytes && a->sig_bytes == b->sig_bytes &&
+           a->pk_bytes == b->pk_bytes && a->sk_bytes == b->sk_bytes &&
+           a->bds_k == b->bds_k;
+}
+
+/**
+ * Checks that every OID of RFC 8391 is in the registry, under a name that
+ * leads back to it, with the params that xmss_xmssmt_initialize_params
+ * derives for it; like xmss_params_custom, the caller sets padding_len. The signature sizes of a few sets are compared to the RFC.
+ */
+static int test_registry(int mt)
+{
+    const xmss_params *p;
+    xmss_params params;
+    uint32_t oid;
+    uint32_t found;
+    int found_mt;
+
+    for (oid = 1; oid <= (mt ? XMSSMT_OIDS : XMSS_OIDS); oid++) {
+        p = xmss_params_lookup(oid, mt);
+        if (p == NULL || xmss_params_name(oid, mt) == NULL) {
+            return -1;
+        }
+        if (xmss_params_lookup_name(&found, &found_mt,
+                                    xmss_params_name(oid, mt)) ||
+            found != oid || found_mt != mt) {
+            return -1;
+        }
+        memset(&params, 0, sizeof(params));
+        params.func = p->func;
+        params.n = p->n;
+        params.padding_len = p->padding_len;
+        params.full_height = p->full_height;
+        params.d = p->d;
+        params.wots_w = p->wots_w;
+        if (xmss_xmssmt_initialize_params(&params) ||
+            !same_params(p, &params)) {
+            return -1;
+        }
+        if ((mt ? xmssmt_parse_oid : xmss_parse_oid)(&params, oid) ||
+            !same_params(p, &params)) {
+            return -1;
+        }
+    }
+    if (xmss_params_lookup(0, mt) != NULL ||
+        xmss_params_lookup(oid, mt) != NULL) {
+        return -1;
+    }
+
+    if (mt) {
+        /* XMSSMT-SHA2_20/2_256 and XMSSMT-SHA2_60/12_256. */
+        return xmss_params_lookup(0x01, 1)->sig_bytes != 4963 ||
+               xmss_params_lookup(0x08, 1)->sig_bytes != 27688;
+    }
+    /* XMSS-SHA2_10_256 and XMSS-SHA2_20_512. */
+    return xmss_params_lookup(0x01, 0)->sig_bytes != 2500 ||
+           xmss_params_lookup(0x06, 0)->sig_bytes != 9732;
+}
+
+/**
+ * Checks that a custom set survives the trip through its private-use OID,
+ * and only as the kind of scheme that it is.
+ */
+static int test_round_trip(unsigned int func, unsigned int n,
+                           unsigned int full_height, unsigned int d,
+                           unsigned int wots_w, unsigned int bds_k)
+{
+    xmss_params params;
+    xmss_params parsed;
+    uint32_t oid;
+
+    if (xmss_params_custom(&params, func, n, full_height, d, wots_w, bds_k) ||
+        xmss_params_to_oid(&oid, &params) ||
+        (oid & 0xff000000) != XMSS_OID_PRIVATE) {
+        return -1;
+    }
+    if (d == 1) {
+        return xmss_parse_oid(&parsed, oid) ||
+               !same_params(&params, &parsed) ||
+               !xmssmt_parse_oid(&parsed, oid);
+    }
+    return xmssmt_parse_oid(&parsed, oid) || !same_params(&params, &parsed) ||
+           !xmss_parse_oid(&parsed, oid);
+}
+
+/**
+ * Checks that a set is refused both as a custom set and as a private-use
+ * OID that encodes it.
+ */
+static int test_refused(unsigned int full_height, unsigned int d,
+                        unsigned int bds_k)
+{
+    xmss_params params;
+    uint32_t oid;
+
+    if (!xmss_params_custom(&params, XMSS_SHA2, 32, full_height, d, 16,
+                            bds_k)) {
+        return -1;
+    }
+    memset(&params, 0, sizeof(params));
+    params.func = XMSS_SHA2;
+    params.n = 32;
+    params.full_height = full_height;
+    params.d = d;
+    params.wots_w = 16;
+    params.bds_k = bds_k;
+    if (xmss_params_to_oid(&oid, &params)) {
+        return -1;
+    }
+    return !(d == 1 ? xmss_parse_oid : xmssmt_parse_oid)(&params, oid);
+}
+
+int main()
+{
+    xmss_params params;
+    int bds;
+
+    printf("Testing the registry of XMSS and XMSSMT parameter sets.. ");
+    if (test_registry(0) || test_registry(1)) {
+        printf("failed!\n");
+        return -1;
+    }
+    printf("successful.\n");
+
+    printf("Testing private-use OIDs of custom parameter sets.. ");
+    if (test_round_trip(XMSS_SHA2, 32, 10, 1, 16, 0) ||
+        test_round_trip(XMSS_SHAKE256, 24, 12, 1, 4, 2) ||
+        test_round_trip(XMSS_SHAKE128, 32, 32, 2, 256, 0) ||
+        test_round_trip(XMSS_SHA2, 64, 62, 2, 16, 3) ||
+        test_round_trip(XMSS_SHAKE256, 64, 30, 6, 16, 1)) {
+        printf("failed!\n");
+        return -1;
+    }
+    printf("successful.\n");
+
+    /* Whether the core keeps BDS state in the key decides about h - k = 5. */
+    if (xmss_params_custom(&params, XMSS_SHA2, 32, 10, 1, 16, 0)) {
+        return -1;
+    }
+    bds = params.sk_bytes != params.index_bytes + 4*params.n;
+
+    printf("Testing that unusable parameter sets are refused.. ");
+    if (test_refused(32, 1, 0) || test_refused(33, 1, 0) ||
+        test_refused(10, 1, 1) ||
+        test_refused(20, 2, 3) ||
+        (bds ? test_refused(5, 1, 0) : test_round_trip(XMSS_SHA2, 32, 5, 1,
+                                                       16, 0))) {
+        printf("failed!\n");
+        return -1;
+    }
+    printf("successful.\n");
+    return 0;
+}
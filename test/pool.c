@@ -0,0 +1,106 @@
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "../params.h"
+#include "../randombytes.h"
+#include "../utils.h"
+#include "../xmss_core.h"
+#include "../xmss_pool.h"
+
+#define MLEN 32
+#define POOL_SIZE 4
+
+/**
+ * Signs with every index of a key, both through a pool and directly, and
+ * checks that the outputs agree and verify, that a flipped bit does not,
+ * and that the pool refuses to sign once the key is used up. Halfway, an
+ * index is used outside of the pool.
+ */
+static int test_params(xmss_params *params, unsigned int interval)
+{
+    unsigned char pk[params->pk_bytes];
+    unsigned char sk1[params->sk_bytes];
+    unsigned char sk2[params->sk_bytes];
+    unsigned char m[MLEN];
+    unsigned char sm1[params->sig_bytes + MLEN];
+    unsigned char sm2[params->sig_bytes + MLEN];
+    unsigned char mout[params->sig_bytes + MLEN];
+    unsigned long long smlen1;
+    unsigned long long smlen2;
+    unsigned long long mlen;
+    unsigned long long last = (1ULL << params->full_height) - 1;
+    xmss_pool *pool;
+    int ret = -1;
+
+    xmssmt_core_keypair(params, pk, sk1);
+    memcpy(sk2, sk1, params->sk_bytes);
+
+    pool = xmss_pool_create(params, sk2, POOL_SIZE, interval);
+    if (pool == NULL) {
+        return -1;
+    }
+    while (bytes_to_ull(sk2, params->index_bytes) < last) {
+        randombytes(m, MLEN);
+        if (bytes_to_ull(sk2, params->index_bytes) == last / 2) {
+            xmssmt_core_sign(params, sk1, sm1, &smlen1, m, MLEN);
+            xmssmt_core_sign(params, sk2, sm2, &smlen2, m, MLEN);
+        }
+        xmssmt_core_sign(params, sk1, sm1, &smlen1, m, MLEN);
+        if (xmssmt_pool_sign(pool, sk2, sm2, &smlen2, m, MLEN) ||
+            smlen1 != smlen2 || memcmp(sm1, sm2, smlen1) ||
+            memcmp(sk1, sk2, params->sk_bytes)) {
+            goto out;
+        }
+        if (xmssmt_core_sign_open(params, mout, &mlen, sm2, smlen2, pk)) {
+            goto out;
+        }
+        sm2[params->index_bytes + params->n] ^= 1;
+        if (!xmssmt_core_sign_open(params, mout, &mlen, sm2, smlen2, pk)) {
+            goto out;
+        }
+    }
+
+    /* The last index is left unused. */
+    if (!xmssmt_pool_sign(pool, sk2, sm2, &smlen2, m, MLEN) ||
+        bytes_to_ull(sk2, params->index_bytes) != last) {
+        goto out;
+    }
+    xmss_pool_destroy(pool);
+    pool = NULL;
+
+    /* A key of the BDS core is longer than index and seeds; it is refused. */
+    params->sk_bytes++;
+    pool = xmss_pool_create(params, sk2, POOL_SIZE, interval);
+    params->sk_bytes--;
+    if (pool == NULL) {
+        ret = 0;
+    }
+out:
+    if (pool != NULL) {
+        xmss_pool_destroy(pool);
+    }
+    return ret;
+}
+
+int main()
+{
+    xmss_params params;
+
+    printf("Testing XMSS signing with a pool.. ");
+    if (xmss_params_custom(&params, XMSS_SHA2, 32, 5, 1, 16, 0) ||
+        test_params(&params, 0) || test_params(&params, 8)) {
+        printf("failed!\n");
+        return -1;
+    }
+    printf("successful.\n");
+
+    printf("Testing XMSSMT signing with a pool.. ");
+    if (xmss_params_custom(&params, XMSS_SHA2, 32, 6, 2, 16, 0) ||
+        test_params(&params, 0) || test_params(&params, 8)) {
+        printf("failed!\n");
+        return -1;
+    }
+    printf("successful.\n");
+    return 0;
+}
@@ -0,0 +1,69 @@
+#include <pthread.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "../randombytes.h"
+
+#define OUTLEN 64
+
+static unsigned int source_calls;
+
+/* A source that counts its calls and always returns the same bytes. */
+static int fixed_source(void *arg, unsigned char *x, unsigned long long xlen)
+{
+    (void)arg;
+    source_calls++;
+    memset(x, 0x5a, xlen);
+    return 0;
+}
+
+static void *thread_output(void *out)
+{
+    randombytes(out, OUTLEN);
+    return NULL;
+}
+
+int main()
+{
+    unsigned char out1[OUTLEN];
+    unsigned char out2[OUTLEN];
+    pthread_t thread;
+    unsigned int i;
+
+    printf("Testing randombytes output of two threads.. ");
+    randombytes(out1, OUTLEN);
+    pthread_create(&thread, NULL, thread_output, out2);
+    pthread_join(thread, NULL);
+    if (!memcmp(out1, out2, OUTLEN)) {
+        printf("failed!\n");
+        return -1;
+    }
+    printf("successful.\n");
+
+    printf("Testing randombytes with an injected source.. ");
+    randombytes_set_source(fixed_source, NULL);
+    randombytes(out1, OUTLEN);
+    randombytes(out2, OUTLEN);
+    if (source_calls != 1 || !memcmp(out1, out2, OUTLEN)) {
+        printf("failed!\n");
+        return -1;
+    }
+    /* Replacing the source starts over from it. */
+    randombytes_set_source(fixed_source, NULL);
+    randombytes(out2, OUTLEN);
+    if (source_calls != 2 || memcmp(out1, out2, OUTLEN)) {
+        printf("failed!\n");
+        return -1;
+    }
+    /* The generator is reseeded periodically. */
+    for (i = 0; i < 5000; i++) {
+        randombytes(out2, OUTLEN);
+    }
+    if (source_calls != 3) {
+        printf("failed!\n");
+        return -1;
+    }
+    randombytes_set_source(NULL, NULL);
+    printf("successful.\n");
+    return 0;
+}
@@ -0,0 +1,453 @@
+/*
+ * Measures how the throughput of keygen, sign and verify scales with the
+ * number of threads, for one parameter set. Each operation is run with
+ * 1, 2, 4, .. threads up to the maximum, with the same amount of work per
+ * thread, and the throughput, speedup and parallel efficiency are reported,
+ * either as a table or, with --json, as one JSON document.
+ *
+ * Usage: scaling [--json] [-t max threads] [-s scale] [parameter set name]
+ *
+ * The operations use the parallel paths of the library:
+ *  - keygen: independent keypairs, one per work item;
+ *  - sign: key-sharded signing, where every thread signs with indices that
+ *    were reserved for it from one key, using the detached signer;
+ *  - verify: the batch verifier, on batches of VERIFY_BATCH signatures;
+ *  - verify_cached: single verifications that share one verifier cache.
+ *
+ * The memory footprint of a thread is reported as the peak stack use, which
+ * is measured by painting the stack before the run, plus the buffers that
+ * the thread allocates. Memory shared by all threads is listed separately.
+ */
+
+#include <pthread.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "../params.h"
+#include "../randombytes.h"
+#include "../utils.h"
+#include "../xmss_core.h"
+#include "../xmss_detached.h"
+#include "../xmss_verify.h"
+
+#define MLEN 32
+#define STACK_BYTES (2 << 20)
+#define STACK_PAINT 0xa5
+/* Signatures kept from the sign runs, to be verified. */
+#define VERIFY_POOL 64
+#define VERIFY_BATCH 8
+/* Levels of the top tree in the verifier cache, and its subtree slots. */
+#define VERIFY_CACHE_LEVELS 8
+#define VERIFY_SUBTREE_SLOTS 1024
+
+typedef enum { OP_KEYGEN, OP_SIGN, OP_VERIFY, OP_VERIFY_CACHED } op_type;
+
+typedef struct {
+    const char *name;
+    op_type type;
+    unsigned int per_thread;
+} operation;
+
+typedef struct {
+    const xmss_params *params;
+    op_type type;
+    unsigned long count;
+    unsigned long next;
+    pthread_mutex_t lock;
+    const unsigned char *pk;
+    const unsigned char *sk;
+    unsigned long long first_idx;
+    unsigned long pool_base;
+    unsigned char **pool;
+    unsigned int pool_size;
+    xmss_verify_cache *cache;
+    int failed;
+} run;
+
+static const operation operations[] = {
+    {"keygen", OP_KEYGEN, 1},
+    {"sign", OP_SIGN, 4},
+    {"verify", OP_VERIFY, 8 * VERIFY_BATCH},
+    {"verify_cached", OP_VERIFY_CACHED, 8 * VERIFY_BATCH},
+};
+
+static double seconds(void)
+{
+    struct timespec t;
+
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return t.tv_sec + t.tv_nsec / 1e9;
+}
+
+/* Takes the next 'step' work items; returns the first, or count if none. */
+static unsigned long take(run *r, unsigned long step)
+{
+    unsigned long i;
+
+    pthread_mutex_lock(&r->lock);
+    i = r->next;
+    r->next = r->next + step < r->count ? r->next + step : r->count;
+    pthread_mutex_unlock(&r->lock);
+    return i;
+}
+
+static void fail(run *r)
+{
+    pthread_mutex_lock(&r->lock);
+    r->failed = 1;
+    pthread_mutex_unlock(&r->lock);
+}
+
+static void *worker(void *arg)
+{
+    run *r = arg;
+    const xmss_params *params = r->params;
+    unsigned long long smlen = params->sig_bytes + MLEN;
+    unsigned char m[MLEN];
+    unsigned char *pk = NULL;
+    unsigned char *sk = NULL;
+    unsigned char *sig = NULL;
+    const unsigned char *sms[VERIFY_BATCH];
+    unsigned long long smlens[VERIFY_BATCH];
+    int results[VERIFY_BATCH];
+    unsigned long i;
+    unsigned long j;
+    unsigned long n;
+
+    randombytes(m, MLEN);
+    if (r->type == OP_KEYGEN) {
+        pk = malloc(params->pk_bytes);
+    }
+    if (r->type == OP_KEYGEN || r->type == OP_SIGN) {
+        sk = malloc(params->sk_bytes);
+    }
+    if (r->type == OP_SIGN) {
+        sig = malloc(params->sig_bytes);
+    }
+    if ((r->type == OP_KEYGEN && (pk == NULL || sk == NULL)) ||
+        (r->type == OP_SIGN && (sk == NULL || sig == NULL))) {
+        fail(r);
+        goto out;
+    }
+
+    for (;;) {
+        n = r->type == OP_VERIFY ? VERIFY_BATCH : 1;
+        i = take(r, n);
+        if (i >= r->count) {
+            break;
+        }
+        n = r->count - i < n ? r->count - i : n;
+
+        switch (r->type) {
+        case OP_KEYGEN:
+            if (xmssmt_core_keypair(params, pk, sk)) {
+                fail(r);
+            }
+            break;
+        case OP_SIGN:
+            memcpy(sk, r->sk, params->sk_bytes);
+            ull_to_bytes(sk, params->index_bytes, r->first_idx + i);
+            if (xmssmt_core_sign_detached(params, sk, sig, m, MLEN)) {
+                fail(r);
+            }
+            else if (r->pool_base + i < VERIFY_POOL) {
+                memcpy(r->pool[r->pool_base + i], sig, params->sig_bytes);
+                memcpy(r->pool[r->pool_base + i] + params->sig_bytes, m, MLEN);
+            }
+            break;
+        case OP_VERIFY:
+            for (j = 0; j < n; j++) {
+                sms[j] = r->pool[(i + j) % r->pool_size];
+                smlens[j] = smlen;
+            }
+            if (xmssmt_core_sign_open_batch(params, results, sms, smlens,
+                                            n, r->pk)) {
+                fail(r);
+            }
+            break;
+        case OP_VERIFY_CACHED:
+            if (xmssmt_core_sign_open_cached(params, r->cache,
+                                             r->pool[i % r->pool_size],
+                                             smlen, r->pk)) {
+                fail(r);
+            }
+            break;
+        }
+    }
+
+out:
+    free(pk);
+    free(sk);
+    free(sig);
+    return NULL;
+}
+
+/* Returns the bytes that a worker allocates for the given operation. */
+static unsigned long long thread_buffers(const xmss_params *params,
+                                         op_type type)
+{
+    switch (type) {
+    case OP_KEYGEN:
+        return params->pk_bytes + params->sk_bytes;
+    case OP_SIGN:
+        return params->sk_bytes + params->sig_bytes;
+    default:
+        return 0;
+    }
+}
+
+/* Returns the number of bytes at the top of a painted stack that were used. */
+static unsigned long long stack_used(const unsigned char *stack)
+{
+    unsigned long long i = 0;
+
+    /* The stack grows downwards, so the untouched part is at the bottom. */
+    while (i < STACK_BYTES && stack[i] == STACK_PAINT) {
+        i++;
+    }
+    return STACK_BYTES - i;
+}
+
+/**
+ * Runs the work items of r on 'threads' threads. Sets *elapsed to the wall
+ * clock time and *stack to the largest stack use of any thread.
+ */
+static int run_threads(run *r, unsigned int threads, double *elapsed,
+                       unsigned long long *stack)
+{
+    pthread_t tids[threads];
+    pthread_attr_t attr;
+    unsigned char *stacks;
+    unsigned long long used;
+    unsigned int started;
+    unsigned int t;
+    double start;
+
+    if (posix_memalign((void **)&stacks, 4096,
+                       (unsigned long long)threads * STACK_BYTES)) {
+        return -1;
+    }
+    memset(stacks, STACK_PAINT, (unsigned long long)threads * STACK_BYTES);
+    r->next = 0;
+    r->failed = 0;
+    pthread_mutex_init(&r->lock, NULL);
+
+    start = seconds();
+    for (started = 0; started < threads; started++) {
+        pthread_attr_init(&attr);
+        pthread_attr_setstack(&attr, stacks + started*STACK_BYTES,
+                              STACK_BYTES);
+        if (pthread_create(&tids[started], &attr, worker, r)) {
+            pthread_attr_destroy(&attr);
+            break;
+        }
+        pthread_attr_destroy(&attr);
+    }
+    for (t = 0; t < started; t++) {
+        pthread_join(tids[t], NULL);
+    }
+    *elapsed = seconds() - start;
+
+    *stack = 0;
+    for (t = 0; t < started; t++) {
+        used = stack_used(stacks + t*STACK_BYTES);
+        *stack = used > *stack ? used : *stack;
+    }
+    pthread_mutex_destroy(&r->lock);
+    free(stacks);
+
+    return started == threads && !r->failed ? 0 : -1;
+}
+
+int main(int argc, char **argv)
+{
+    const char *name = "XMSS-SHA2_10_256";
+    xmss_params params;
+    xmss_verify_cache cache;
+    uint32_t oid;
+    long max_threads = sysconf(_SC_NPROCESSORS_ONLN);
+    unsigned int scale = 1;
+    unsigned int counts[64];
+    unsigned int ncounts = 0;
+    unsigned int threads;
+    unsigned int i;
+    unsigned int j;
+    unsigned long long next_idx;
+    unsigned long long stack;
+    unsigned long long shared;
+    double elapsed;
+    double throughput;
+    double base = 0;
+    int json = 0;
+    run r;
+
+    for (argc--, argv++; argc > 0 && argv[0][0] == '-'; argc--, argv++) {
+        if (!strcmp(argv[0], "--json")) {
+            json = 1;
+        }
+        else if (!strcmp(argv[0], "-t") && argc > 1 && atol(argv[1]) > 0) {
+            max_threads = atol(argv[1]);
+            argc--;
+            argv++;
+        }
+        else if (!strcmp(argv[0], "-s") && argc > 1 && atoi(argv[1]) > 0) {
+            scale = atoi(argv[1]);
+            argc--;
+            argv++;
+        }
+        else {
+            break;
+        }
+    }
+    if (argc > 1 || (argc == 1 && argv[0][0] == '-') || max_threads < 1) {
+        fprintf(stderr, "Usage: scaling [--json] [-t max threads] "
+                        "[-s scale] [parameter set name]\n");
+        return -1;
+    }
+    if (argc == 1) {
+        name = argv[0];
+    }
+    if (!strncmp(name, "XMSSMT-", 7)) {
+        if (xmssmt_str_to_oid(&oid, name) ||
+            xmssmt_parse_oid(&params, oid)) {
+            fprintf(stderr, "Unknown parameter set %s.\n", name);
+            return -1;
+        }
+    }
+    else if (xmss_str_to_oid(&oid, name) || xmss_parse_oid(&params, oid)) {
+        fprintf(stderr, "Unknown parameter set %s.\n", name);
+        return -1;
+    }
+
+    /* Powers of two, followed by the maximum itself. */
+    for (threads = 1; threads < (unsigned long)max_threads && ncounts < 63; threads *= 2) {
+        counts[ncounts++] = threads;
+    }
+    counts[ncounts++] = max_threads;
+
+    unsigned char pk[params.pk_bytes];
+    unsigned char sk[params.sk_bytes];
+    unsigned char *pool[VERIFY_POOL];
+    unsigned char *pool_buf = malloc(VERIFY_POOL *
+                                     (params.sig_bytes + MLEN));
+
+    if (pool_buf == NULL ||
+        xmss_verify_cache_init(&params, &cache,
+                               params.tree_height < VERIFY_CACHE_LEVELS
+                                   ? params.tree_height : VERIFY_CACHE_LEVELS,
+                               VERIFY_SUBTREE_SLOTS)) {
+        fprintf(stderr, "Out of memory.\n");
+        return -1;
+    }
+    for (i = 0; i < VERIFY_POOL; i++) {
+        pool[i] = pool_buf + i*(params.sig_bytes + MLEN);
+    }
+    xmssmt_core_keypair(&params, pk, sk);
+    next_idx = bytes_to_ull(sk, params.index_bytes);
+
+    memset(&r, 0, sizeof(run));
+    r.params = &params;
+    r.pk = pk;
+    r.sk = sk;
+    r.pool = pool;
+    r.cache = &cache;
+
+    shared = VERIFY_POOL * (params.sig_bytes + MLEN);
+    shared += (1ULL << (params.tree_height < VERIFY_CACHE_LEVELS
+                        ? params.tree_height : VERIFY_CACHE_LEVELS)) *
+              (params.n + 1);
+    if (params.d > 1) {
+        shared += VERIFY_SUBTREE_SLOTS *
+                  (1 + sizeof(unsigned int) + sizeof(unsigned long long) +
+                   params.n);
+    }
+
+    if (json) {
+        printf("{\"name\": \"%s\", \"oid\": %u, \"shared_bytes\": %llu, "
+               "\"operations\": [", name, oid, shared);
+    }
+    else {
+        printf("%s, %llu bytes shared by all threads\n", name, shared);
+    }
+
+    for (i = 0; i < sizeof(operations) / sizeof(operations[0]); i++) {
+        r.type = operations[i].type;
+        if (r.type == OP_VERIFY || r.type == OP_VERIFY_CACHED) {
+            r.pool_size = r.pool_base < VERIFY_POOL ? r.pool_base
+                                                    : VERIFY_POOL;
+            if (r.pool_size == 0) {
+                fprintf(stderr, "No signatures to verify.\n");
+                return -1;
+            }
+        }
+        if (json) {
+            printf("%s\n    {\"op\": \"%s\", \"runs\": [",
+                   i ? "," : "", operations[i].name);
+        }
+        else {
+            printf("\n%-14s %8s %8s %10s %12s %9s %11s %14s\n", "operation",
+                   "threads", "ops", "seconds", "ops/s", "speedup",
+                   "efficiency", "bytes/thread");
+        }
+
+        for (j = 0; j < ncounts; j++) {
+            threads = counts[j];
+            r.count = (unsigned long)operations[i].per_thread * scale * threads;
+            if (r.type == OP_SIGN) {
+                /* Reserve the indices of this run. */
+                if (r.count > (1ULL << params.full_height) - 1 - next_idx) {
+                    fprintf(stderr, "Not enough indices left to sign.\n");
+                    return -1;
+                }
+                r.first_idx = next_idx;
+                next_idx += r.count;
+            }
+            if (run_threads(&r, threads, &elapsed, &stack)) {
+                fprintf(stderr, "%s failed with %u threads.\n",
+                        operations[i].name, threads);
+                return -1;
+            }
+            if (r.type == OP_SIGN) {
+                r.pool_base += r.count;
+            }
+
+            throughput = r.count / elapsed;
+            if (j == 0) {
+                base = throughput / threads;
+            }
+            stack += thread_buffers(&params, r.type);
+
+            if (json) {
+                printf("%s\n        {\"threads\": %u, \"ops\": %lu, "
+                       "\"seconds\": %.6f, \"ops_per_second\": %.3f, "
+                       "\"speedup\": %.3f, \"efficiency\": %.3f, "
+                       "\"bytes_per_thread\": %llu}",
+                       j ? "," : "", threads, r.count, elapsed, throughput,
+                       throughput / base, throughput / (base * threads),
+                       stack);
+            }
+            else {
+                printf("%-14s %8u %8lu %10.3f %12.2f %9.2f %11.2f %14llu\n",
+                       operations[i].name, threads, r.count, elapsed,
+                       throughput, throughput / base,
+                       throughput / (base * threads), stack);
+            }
+            fflush(stdout);
+        }
+        if (json) {
+            printf("\n    ]}");
+        }
+    }
+    if (json) {
+        printf("\n]}\n");
+    }
+
+    xmss_verify_cache_free(&cache);
+    free(pool_buf);
+
+    return 0;
+}
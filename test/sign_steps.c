@@ -0,0 +1,94 @@
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "../params.h"
+#include "../randombytes.h"
+#include "../utils.h"
+#include "../xmss_core.h"
+#include "../xmss_core_steps.h"
+
+#define MLEN 32
+#define SIGNATURES 2
+
+static int test_oid(uint32_t oid, int mt)
+{
+    xmss_params params;
+    xmss_sign_state state;
+    unsigned int i;
+    int steps;
+
+    if (mt) {
+        xmssmt_parse_oid(&params, oid);
+    } else {
+        xmss_parse_oid(&params, oid);
+    }
+
+    unsigned char pk[params.pk_bytes];
+    unsigned char sk1[params.sk_bytes];
+    unsigned char sk2[params.sk_bytes];
+    unsigned char m[MLEN];
+    unsigned char sm1[params.sig_bytes + MLEN];
+    unsigned char sm2[params.sig_bytes + MLEN];
+    unsigned long long smlen1;
+    unsigned long long smlen2;
+
+    xmssmt_core_keypair(&params, pk, sk1);
+    memcpy(sk2, sk1, params.sk_bytes);
+
+    for (i = 0; i < SIGNATURES; i++) {
+        randombytes(m, MLEN);
+        xmssmt_core_sign(&params, sk1, sm1, &smlen1, m, MLEN);
+
+        steps = 1;
+        xmssmt_core_sign_begin(&params, &state, sk2, sm2, &smlen2, m, MLEN);
+        while (xmssmt_core_sign_step(&state, 1000)) {
+            steps++;
+        }
+        xmssmt_core_sign_finish(&state);
+
+        if (smlen1 != smlen2 || memcmp(sm1, sm2, smlen1) ||
+            memcmp(sk1, sk2, params.sk_bytes)) {
+            return -1;
+        }
+    }
+
+    /* The last index of a key is not used. */
+    ull_to_bytes(sk2, params.index_bytes, (1ULL << params.full_height) - 1);
+    memcpy(sk1, sk2, params.sk_bytes);
+    if (!xmssmt_core_sign_begin(&params, &state, sk2, sm2, &smlen2, m, MLEN) ||
+        memcmp(sk1, sk2, params.sk_bytes)) {
+        return -1;
+    }
+
+    /* A key of the BDS core is longer than index and seeds; it is refused
+       and left unchanged. */
+    ull_to_bytes(sk2, params.index_bytes, 0);
+    memcpy(sk1, sk2, params.sk_bytes);
+    params.sk_bytes++;
+    if (!xmssmt_core_sign_begin(&params, &state, sk2, sm2, &smlen2, m, MLEN) ||
+        !xmssmt_core_sign_msg_init(&params, &state, sk2, sm2) ||
+        memcmp(sk1, sk2, params.sk_bytes - 1)) {
+        return -1;
+    }
+    printf("%d steps.. ", steps);
+    return 0;
+}
+
+int main()
+{
+    printf("Testing step-wise XMSS signing.. ");
+    if (test_oid(0x00000001, 0)) {
+        printf("failed!\n");
+        return -1;
+    }
+    printf("successful.\n");
+
+    printf("Testing step-wise XMSSMT signing.. ");
+    if (test_oid(0x00000002, 1)) {
+        printf("failed!\n");
+        return -1;
+    }
+    printf("successful.\n");
+    return 0;
+}
@@ -0,0 +1,401 @@
+/*
+ * Benchmarks the primitives and the complete scheme for a number of
+ * parameter sets. Every operation is timed individually, and the median and
+ * 99th percentile are reported in cycles and in nanoseconds, either as a
+ * table or, with --json, as one JSON document.
+ *
+ * Usage: speed [--json] [-s scale] [parameter set names ..]
+ *
+ * Without names, one parameter set is benchmarked for every combination of
+ * hash function and n, all with a tree of height 10. The number of runs of
+ * each operation is multiplied by 'scale'.
+ *
+ * When compiled with -DXMSS_HASH_STATS, the hash function calls of each
+ * operation are counted per domain and reported as well.
+ */
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "../hash.h"
+#include "../params.h"
+#include "../randombytes.h"
+#include "../utils.h"
+#include "../wots.h"
+#include "../xmss_commons.h"
+#include "../xmss_core.h"
+
+#define MLEN 32
+
+#ifdef XMSS_HASH_STATS
+static const char *domains[XMSS_HASH_DOMAINS] = {
+    "F", "H", "HASH", "PRF", "PRF_KEYGEN"
+};
+#endif
+
+typedef struct {
+    const xmss_params *params;
+    unsigned char *seed;
+    unsigned char *pub_seed;
+    unsigned char *in;
+    unsigned char *out;
+    unsigned char *msg;
+    unsigned char *wots_sig;
+    unsigned char *wots_pk;
+    unsigned char *pk;
+    unsigned char *sk;
+    unsigned char *sm;
+    unsigned long long smlen;
+    unsigned char *m;
+    uint32_t addr[8];
+    uint32_t addr2[8];
+} bench_state;
+
+typedef struct {
+    const char *name;
+    void (*op)(bench_state *);
+    unsigned int runs;
+} benchmark;
+
+/* The default parameter sets: every hash function and n, height 10. */
+static const char *default_sets[] = {
+    "XMSS-SHA2_10_192", "XMSS-SHA2_10_256", "XMSS-SHA2_10_512",
+    "XMSS-SHAKE_10_256", "XMSS-SHAKE_10_512",
+    "XMSS-SHAKE256_10_192", "XMSS-SHAKE256_10_256",
+};
+
+static unsigned long long cpucycles(void)
+{
+#if defined(__x86_64__) || defined(__i386__)
+    unsigned int lo, hi;
+
+    __asm__ __volatile__ ("rdtsc" : "=a" (lo), "=d" (hi));
+    return ((unsigned long long)hi << 32) | lo;
+#else
+    return 0;
+#endif
+}
+
+static unsigned long long nanoseconds(void)
+{
+    struct timespec t;
+
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return (unsigned long long)t.tv_sec * 1000000000ULL + t.tv_nsec;
+}
+
+/* core_hash is timed on the input of thash_f, the most common one. */
+static void bench_core_hash(bench_state *s)
+{
+    core_hash(s->params, s->out, s->in,
+              s->params->padding_len + 2*s->params->n);
+}
+
+static void bench_prf(bench_state *s)
+{
+    prf(s->params, s->out, s->in, s->seed);
+}
+
+static void bench_thash_f(bench_state *s)
+{
+    thash_f(s->params, s->out, s->in, s->pub_seed, s->addr);
+}
+
+static void bench_thash_h(bench_state *s)
+{
+    thash_h(s->params, s->out, s->in, s->pub_seed, s->addr);
+}
+
+/* A complete chain, from position 0 to w - 1. */
+static void bench_gen_chain(bench_state *s)
+{
+    gen_chain(s->params, s->out, s->in, 0, s->params->wots_w - 1,
+              s->pub_seed, s->addr);
+}
+
+static void bench_wots_pkgen(bench_state *s)
+{
+    wots_pkgen(s->params, s->wots_pk, s->seed, s->pub_seed, s->addr);
+}
+
+static void bench_wots_sign(bench_state *s)
+{
+    wots_sign(s->params, s->wots_sig, s->msg, s->seed, s->pub_seed, s->addr);
+}
+
+static void bench_wots_pk_from_sig(bench_state *s)
+{
+    wots_pk_from_sig(s->params, s->wots_pk, s->wots_sig, s->msg,
+                     s->pub_seed, s->addr);
+}
+
+static void bench_leaf(bench_state *s)
+{
+    gen_leaf_wots(s->params, s->out, s->seed, s->pub_seed, s->addr, s->addr2);
+}
+
+static void bench_keygen(bench_state *s)
+{
+    xmssmt_core_keypair(s->params, s->pk, s->sk);
+}
+
+static void bench_sign(bench_state *s)
+{
+    if (xmssmt_core_sign(s->params, s->sk, s->sm, &s->smlen, s->m, MLEN)) {
+        fprintf(stderr, "Signing failed during benchmark.\n");
+    }
+}
+
+/* Signing leaves the last index of a key unused. */
+static int key_used_up(const bench_state *s)
+{
+    return bytes_to_ull(s->sk, s->params->index_bytes) >=
+           (1ULL << s->params->full_height) - 1;
+}
+
+static void bench_verify(bench_state *s)
+{
+    unsigned long long mlen;
+
+    if (xmssmt_core_sign_open(s->params, s->out, &mlen,
+                              s->sm, s->smlen, s->pk)) {
+        fprintf(stderr, "Verification failed during benchmark.\n");
+    }
+}
+
+/* keygen runs first, so that sign and verify use its key. */
+static const benchmark benchmarks[] = {
+    {"core_hash", bench_core_hash, 10000},
+    {"prf", bench_prf, 10000},
+    {"thash_f", bench_thash_f, 10000},
+    {"thash_h", bench_thash_h, 10000},
+    {"gen_chain", bench_gen_chain, 1000},
+    {"wots_pkgen", bench_wots_pkgen, 100},
+    {"wots_sign", bench_wots_sign, 100},
+    {"wots_pk_from_sig", bench_wots_pk_from_sig, 100},
+    {"leaf", bench_leaf, 100},
+    {"keygen", bench_keygen, 2},
+    {"sign", bench_sign, 16},
+    {"verify", bench_verify, 16},
+};
+
+static int compare(const void *a, const void *b)
+{
+    unsigned long long x = *(const unsigned long long *)a;
+    unsigned long long y = *(const unsigned long long *)b;
+
+    return (x > y) - (x < y);
+}
+
+/* Sorts the samples, and returns the median and the 99th percentile. */
+static void percentiles(unsigned long long *t, unsigned int runs,
+                        unsigned long long *median, unsigned long long *p99)
+{
+    qsort(t, runs, sizeof(unsigned long long), compare);
+    if (runs % 2) {
+        *median = t[runs / 2];
+    }
+    else {
+        *median = (t[runs / 2 - 1] + t[runs / 2]) / 2;
+    }
+    *p99 = t[(99 * runs + 99) / 100 - 1];
+}
+
+static int bench_set(const char *name, unsigned int scale, int json,
+                     int first)
+{
+    xmss_params params;
+    bench_state s;
+    uint32_t oid;
+    unsigned int i;
+    unsigned int j;
+    unsigned int runs;
+    unsigned long long c0, t0;
+    unsigned long long cycles_median, cycles_p99;
+    unsigned long long ns_median, ns_p99;
+    xmss_hash_stats stats;
+#ifdef XMSS_HASH_STATS
+    unsigned int k;
+#endif
+
+    if (!strncmp(name, "XMSSMT-", 7)) {
+        if (xmssmt_str_to_oid(&oid, name) ||
+            xmssmt_parse_oid(&params, oid)) {
+            return -1;
+        }
+    }
+    else if (xmss_str_to_oid(&oid, name) || xmss_parse_oid(&params, oid)) {
+        return -1;
+    }
+
+    unsigned char seed[params.n];
+    unsigned char pub_seed[params.n];
+    unsigned char in[params.padding_len + 3*params.n + 32];
+    unsigned char out[params.sig_bytes + MLEN];
+    unsigned char msg[params.n];
+    unsigned char wots_sig[params.wots_sig_bytes];
+    unsigned char wots_pk[params.wots_sig_bytes];
+    unsigned char pk[params.pk_bytes];
+    unsigned char *sk = malloc(params.sk_bytes);
+    unsigned char *sm = malloc(params.sig_bytes + MLEN);
+    unsigned char m[MLEN];
+    unsigned long long *cycles = malloc(10000 * scale * sizeof(*cycles));
+    unsigned long long *ns = malloc(10000 * scale * sizeof(*ns));
+
+    if (sk == NULL || sm == NULL || cycles == NULL || ns == NULL) {
+        free(sk);
+        free(sm);
+        free(cycles);
+        free(ns);
+        return -1;
+    }
+
+    memset(&s, 0, sizeof(bench_state));
+    s.params = &params;
+    s.seed = seed;
+    s.pub_seed = pub_seed;
+    s.in = in;
+    s.out = out;
+    s.msg = msg;
+    s.wots_sig = wots_sig;
+    s.wots_pk = wots_pk;
+    s.pk = pk;
+    s.sk = sk;
+    s.sm = sm;
+    s.m = m;
+    randombytes(seed, params.n);
+    randombytes(pub_seed, params.n);
+    randombytes(in, sizeof(in));
+    randombytes(msg, params.n);
+    randombytes(m, MLEN);
+    wots_sign(&params, wots_sig, msg, seed, pub_seed, s.addr);
+
+    if (json) {
+        printf("%s\n    {\"name\": \"%s\", \"oid\": %u, \"results\": [",
+               first ? "" : ",", name, oid);
+    }
+    else {
+        printf("%s\n%-18s %8s %14s %14s %14s %14s\n", name, "operation",
+               "runs", "cycles (med)", "cycles (p99)", "ns (med)", "ns (p99)");
+    }
+
+    for (i = 0; i < sizeof(benchmarks) / sizeof(benchmarks[0]); i++) {
+        runs = benchmarks[i].runs * scale;
+        for (j = 0; j < runs; j++) {
+            /* Signing consumes indices; once they are used up, it
+               continues with a fresh key. Verification needs a signature. */
+            if ((benchmarks[i].op == bench_sign ||
+                 (benchmarks[i].op == bench_verify && j == 0)) &&
+                key_used_up(&s)) {
+                bench_keygen(&s);
+            }
+            if (benchmarks[i].op == bench_verify && j == 0) {
+                bench_sign(&s);
+            }
+            xmss_hash_stats_reset();
+            c0 = cpucycles();
+            t0 = nanoseconds();
+            benchmarks[i].op(&s);
+            ns[j] = nanoseconds() - t0;
+            cycles[j] = cpucycles() - c0;
+        }
+        xmss_hash_stats_get(&stats);
+        percentiles(cycles, runs, &cycles_median, &cycles_p99);
+        percentiles(ns, runs, &ns_median, &ns_p99);
+
+        if (json) {
+            printf("%s\n        {\"op\": \"%s\", \"runs\": %u, "
+                   "\"cycles\": {\"median\": %llu, \"p99\": %llu}, "
+                   "\"ns\": {\"median\": %llu, \"p99\": %llu}",
+                   i ? "," : "", benchmarks[i].name, runs,
+                   cycles_median, cycles_p99, ns_median, ns_p99);
+#ifdef XMSS_HASH_STATS
+            printf(", \"hash_calls\": {");
+            for (k = 0; k < XMSS_HASH_DOMAINS; k++) {
+                printf("%s\"%s\": %llu", k ? ", " : "", domains[k],
+                       stats.calls[k]);
+            }
+            printf("}, \"hash_bytes\": {");
+            for (k = 0; k < XMSS_HASH_DOMAINS; k++) {
+                printf("%s\"%s\": %llu", k ? ", " : "", domains[k],
+                       stats.bytes[k]);
+            }
+            printf("}");
+#endif
+            printf("}");
+        }
+        else {
+            printf("%-18s %8u %14llu %14llu %14llu %14llu\n",
+                   benchmarks[i].name, runs,
+                   cycles_median, cycles_p99, ns_median, ns_p99);
+#ifdef XMSS_HASH_STATS
+            printf("%-18s", "  hash calls");
+            for (k = 0; k < XMSS_HASH_DOMAINS; k++) {
+                printf(" %s %llu", domains[k], stats.calls[k]);
+            }
+            printf("\n");
+#endif
+        }
+        fflush(stdout);
+    }
+    if (json) {
+        printf("\n    ]}");
+    }
+    else {
+        printf("\n");
+    }
+
+    free(sk);
+    free(sm);
+    free(cycles);
+    free(ns);
+    return 0;
+}
+
+int main(int argc, char **argv)
+{
+    const char **sets = default_sets;
+    unsigned int count = sizeof(default_sets) / sizeof(default_sets[0]);
+    unsigned int scale = 1;
+    unsigned int i;
+    int json = 0;
+
+    for (argc--, argv++; argc > 0 && argv[0][0] == '-'; argc--, argv++) {
+        if (!strcmp(argv[0], "--json")) {
+            json = 1;
+        }
+        else if (!strcmp(argv[0], "-s") && argc > 1 && atoi(argv[1]) > 0) {
+            scale = atoi(argv[1]);
+            argc--;
+            argv++;
+        }
+        else {
+            fprintf(stderr, "Usage: speed [--json] [-s scale] "
+                            "[parameter set names ..]\n");
+            return -1;
+        }
+    }
+    if (argc > 0) {
+        sets = (const char **)argv;
+        count = argc;
+    }
+
+    if (json) {
+        printf("{\"cycles_available\": %s, \"parameter_sets\": [",
+               cpucycles() ? "true" : "false");
+    }
+    for (i = 0; i < count; i++) {
+        if (bench_set(sets[i], scale, json, i == 0)) {
+            fprintf(stderr, "Could not benchmark %s.\n", sets[i]);
+            return -1;
+        }
+    }
+    if (json) {
+        printf("\n]}\n");
+    }
+
+    return 0;
+}
@@ -0,0 +1,106 @@
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "../params.h"
+#include "../randombytes.h"
+#include "../xmss_core.h"
+#include "../xmss_verify.h"
+
+#define MLEN 32
+/* A key of 2 layers of height 2 has 4 bottom subtrees, and 15 usable
+   signatures, so that every subtree is signed from. */
+#define HEIGHT 4
+#define LAYERS 2
+#define SIGNATURES 15
+
+static unsigned int count_set(const unsigned char *valid, unsigned int len)
+{
+    unsigned int i;
+    unsigned int count = 0;
+
+    for (i = 0; i < len; i++) {
+        count += valid[i] != 0;
+    }
+    return count;
+}
+
+/**
+ * Verifies all signatures of a key twice with a cache of 2^k top tree nodes,
+ * and checks that the subtree cache ends up with the roots of all bottom
+ * subtrees, also once the node cache lets verifications stop early.
+ */
+static int test_cache(const xmss_params *params, unsigned int k)
+{
+    xmss_verify_cache cache;
+    unsigned char pk[params->pk_bytes];
+    unsigned char sk[params->sk_bytes];
+    unsigned char m[MLEN];
+    unsigned char sm[SIGNATURES][params->sig_bytes + MLEN];
+    unsigned long long smlen;
+    unsigned int i;
+    unsigned int round;
+    int ret = -1;
+
+    xmssmt_core_keypair(params, pk, sk);
+    for (i = 0; i < SIGNATURES; i++) {
+        randombytes(m, MLEN);
+        if (xmssmt_core_sign(params, sk, sm[i], &smlen, m, MLEN)) {
+            return -1;
+        }
+    }
+
+    if (xmss_verify_cache_init(params, &cache, k, 16)) {
+        return -1;
+    }
+    for (round = 0; round < 2; round++) {
+        for (i = 0; i < SIGNATURES; i++) {
+            if (xmssmt_core_sign_open_cached(params, &cache, sm[i],
+                                             params->sig_bytes + MLEN, pk)) {
+                goto out;
+            }
+        }
+    }
+    if (count_set(cache.subtree_valid, 16) != 1U << (HEIGHT / LAYERS)) {
+        goto out;
+    }
+    if (k > 0 && count_set(cache.valid, 1U << k) != 1U << k) {
+        goto out;
+    }
+
+    /* A signature with a flipped bit in its bottom layer does not verify. */
+    sm[0][params->index_bytes + params->n] ^= 1;
+    if (!xmssmt_core_sign_open_cached(params, &cache, sm[0],
+                                      params->sig_bytes + MLEN, pk)) {
+        goto out;
+    }
+    ret = 0;
+out:
+    xmss_verify_cache_free(&cache);
+    return ret;
+}
+
+int main()
+{
+    xmss_params params;
+
+    if (xmss_params_custom(&params, XMSS_SHA2, 32, HEIGHT, LAYERS, 16, 0)) {
+        printf("Could not set up the parameters!\n");
+        return -1;
+    }
+
+    printf("Testing the subtree cache on its own.. ");
+    if (test_cache(&params, 0)) {
+        printf("failed!\n");
+        return -1;
+    }
+    printf("successful.\n");
+
+    printf("Testing the subtree cache with the node cache.. ");
+    if (test_cache(&params, 1)) {
+        printf("failed!\n");
+        return -1;
+    }
+    printf("successful.\n");
+    return 0;
+}
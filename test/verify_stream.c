@@ -0,0 +1,122 @@
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "../params.h"
+#include "../randombytes.h"
+#include "../xmss_core.h"
+#include "../xmss_verify_stream.h"
+
+#define MLEN 100
+#define SIGNATURES 2
+
+/**
+ * Verifies the signature sig on m, passing both in parts of 'part' bytes.
+ * With msg_first, the whole message is passed before the signature that
+ * follows its header; otherwise, it is passed after the whole signature.
+ */
+static int verify(const xmss_params *params, const unsigned char *sig,
+                  const unsigned char *m, const unsigned char *pk,
+                  unsigned long long part, int msg_first)
+{
+    xmss_verify_stream state;
+    unsigned long long header = params->index_bytes + params->n;
+    unsigned long long offset;
+    unsigned long long len;
+
+    if (xmssmt_core_verify_begin(params, &state, pk)) {
+        return -1;
+    }
+    xmssmt_core_verify_sig_update(&state, sig, header);
+    if (msg_first) {
+        for (offset = 0; offset < MLEN; offset += len) {
+            len = MLEN - offset < part ? MLEN - offset : part;
+            xmssmt_core_verify_msg_update(&state, m + offset, len);
+        }
+        xmssmt_core_verify_msg_final(&state);
+    }
+    for (offset = header; offset < params->sig_bytes; offset += len) {
+        len = params->sig_bytes - offset < part
+              ? params->sig_bytes - offset : part;
+        xmssmt_core_verify_sig_update(&state, sig + offset, len);
+    }
+    if (!msg_first) {
+        for (offset = 0; offset < MLEN; offset += len) {
+            len = MLEN - offset < part ? MLEN - offset : part;
+            xmssmt_core_verify_msg_update(&state, m + offset, len);
+        }
+    }
+    return xmssmt_core_verify_finish(&state);
+}
+
+/**
+ * Checks that signatures verify when passed in parts of various sizes, in
+ * either order, and that a flipped bit in the message or in any section of
+ * the signature does not.
+ */
+static int test_params(const xmss_params *params)
+{
+    unsigned long long parts[] = {1, 7, params->n, params->n + 1,
+                                  params->sig_bytes};
+    unsigned char pk[params->pk_bytes];
+    unsigned char sk[params->sk_bytes];
+    unsigned char m[MLEN];
+    unsigned char sm[params->sig_bytes + MLEN];
+    unsigned long long smlen;
+    unsigned long long flip;
+    unsigned int i;
+    unsigned int p;
+
+    xmssmt_core_keypair(params, pk, sk);
+
+    for (i = 0; i < SIGNATURES; i++) {
+        randombytes(m, MLEN);
+        xmssmt_core_sign(params, sk, sm, &smlen, m, MLEN);
+
+        for (p = 0; p < sizeof(parts) / sizeof(parts[0]); p++) {
+            if (verify(params, sm, m, pk, parts[p], 0) ||
+                verify(params, sm, m, pk, parts[p], 1)) {
+                return -1;
+            }
+        }
+
+        m[MLEN - 1] ^= 1;
+        if (!verify(params, sm, m, pk, params->n, 1)) {
+            return -1;
+        }
+        m[MLEN - 1] ^= 1;
+
+        /* The bits are in R, a WOTS chain and an authentication path node. */
+        for (flip = params->index_bytes; flip < params->sig_bytes;
+             flip += params->wots_sig_bytes + params->n) {
+            sm[flip] ^= 1;
+            if (!verify(params, sm, m, pk, params->n, 1)) {
+                return -1;
+            }
+            sm[flip] ^= 1;
+        }
+    }
+    return 0;
+}
+
+int main()
+{
+    xmss_params params;
+
+    printf("Testing streaming XMSS verification.. ");
+    if (xmss_params_custom(&params, XMSS_SHA2, 32, 5, 1, 16, 0) ||
+        test_params(&params)) {
+        printf("failed!\n");
+        return -1;
+    }
+    printf("successful.\n");
+
+    printf("Testing streaming XMSSMT verification.. ");
+    if (xmss_params_custom(&params, XMSS_SHAKE256, 24, 6, 2, 16, 0) ||
+        test_params(&params)) {
+        printf("failed!\n");
+        return -1;
+    }
+    printf("successful.\n");
+    return 0;
+}
@@ -1,42 +1,102 @@
 #include <stdio.h>
 #include <stdint.h>
+#include <stdlib.h>
 #include <string.h>
 
+#include "../hash.h"
 #include "../wots.h"
 #include "../randombytes.h"
 #include "../params.h"
 
-int main()
+/* Tests WOTS, its _ctx variants and its checkpoints for one set. */
+static int test_params(const xmss_params *params)
 {
-    xmss_params params;
-    // TODO test more different OIDs
-    uint32_t oid = 0x00000001;
-
-    /* For WOTS it doesn't matter if we use XMSS or XMSSMT. */
-    xmss_parse_oid(&params, oid);
-
-    unsigned char seed[params.n];
-    unsigned char pub_seed[params.n];
-    unsigned char pk1[params.wots_sig_bytes];
-    unsigned char pk2[params.wots_sig_bytes];
-    unsigned char sig[params.wots_sig_bytes];
-    unsigned char m[params.n];
+    unsigned char seed[params->n];
+    unsigned char pub_seed[params->n];
+    unsigned char pk1[params->wots_sig_bytes];
+    unsigned char pk2[params->wots_sig_bytes];
+    unsigned char sig[params->wots_sig_bytes];
+    unsigned char sig2[params->wots_sig_bytes];
+    unsigned char *cp;
+    unsigned int interval;
+    unsigned char m[params->n];
     uint32_t addr[8] = {0};
+    xmss_thash_ctx ctx;
+    int ret = -1;
 
-    randombytes(seed, params.n);
-    randombytes(pub_seed, params.n);
-    randombytes(m, params.n);
+    randombytes(seed, params->n);
+    randombytes(pub_seed, params->n);
+    randombytes(m, params->n);
     randombytes((unsigned char *)addr, 8 * sizeof(uint32_t));
 
-    printf("Testing WOTS signature and PK derivation.. ");
+    wots_pkgen(params, pk1, seed, pub_seed, addr);
+    wots_sign(params, sig, m, seed, pub_seed, addr);
+    wots_pk_from_sig(params, pk2, sig, m, pub_seed, addr);
+    if (memcmp(pk1, pk2, params->wots_sig_bytes)) {
+        return -1;
+    }
 
-    wots_pkgen(&params, pk1, seed, pub_seed, addr);
-    wots_sign(&params, sig, m, seed, pub_seed, addr);
-    wots_pk_from_sig(&params, pk2, sig, m, pub_seed, addr);
+    /* The variants that keep the hash state compute the same. */
+    thash_ctx_init(params, &ctx, pub_seed);
+    wots_pkgen_ctx(params, &ctx, pk2, seed, addr);
+    if (memcmp(pk1, pk2, params->wots_sig_bytes)) {
+        goto out;
+    }
+    wots_sign_ctx(params, &ctx, sig2, m, seed, addr);
+    if (memcmp(sig, sig2, params->wots_sig_bytes)) {
+        goto out;
+    }
+    wots_pk_from_sig_ctx(params, &ctx, pk2, sig, m, addr);
+    if (memcmp(pk1, pk2, params->wots_sig_bytes)) {
+        goto out;
+    }
 
-    if (memcmp(pk1, pk2, params.wots_sig_bytes)) {
-        printf("failed!\n");
-        return -1;
+    cp = malloc(params->wots_sig_bytes * params->wots_w);
+    if (cp == NULL) {
+        goto out;
+    }
+    for (interval = 1; interval <= params->wots_w; interval *= 2) {
+        wots_checkpoints(params, cp, seed, pub_seed, addr, interval);
+        wots_sign_checkpoints(params, sig2, m, cp, interval, pub_seed, addr);
+        if (memcmp(sig, sig2, params->wots_sig_bytes)) {
+            break;
+        }
+    }
+    free(cp);
+    if (interval > params->wots_w) {
+        ret = 0;
+    }
+out:
+    thash_ctx_release(&ctx);
+    return ret;
+}
+
+int main()
+{
+    xmss_params params;
+    unsigned int funcs[] = {XMSS_SHA2, XMSS_SHAKE128, XMSS_SHAKE256};
+    unsigned int ns[] = {24, 32, 64};
+    unsigned int ws[] = {4, 16, 256};
+    unsigned int f, n, w;
+
+    printf("Testing WOTS signatures, PK derivation and checkpoints.. ");
+
+    /* For WOTS it doesn't matter if we use XMSS or XMSSMT. */
+    for (f = 0; f < sizeof(funcs) / sizeof(funcs[0]); f++) {
+        for (n = 0; n < sizeof(ns) / sizeof(ns[0]); n++) {
+            for (w = 0; w < sizeof(ws) / sizeof(ws[0]); w++) {
+                /* Not every hash function comes with every n. */
+                if (xmss_params_custom(&params, funcs[f], ns[n], 10, 1,
+                                       ws[w], 0)) {
+                    continue;
+                }
+                if (test_params(&params)) {
+                    printf("failed for func %u, n %u, w %u!\n",
+                           funcs[f], ns[n], ws[w]);
+                    return -1;
+                }
+            }
+        }
     }
     printf("successful.\n");
     return 0;
@@ -1,33 +1,123 @@
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
 
 #include "../params.h"
-#include "../xmss.h"
+#include "../xmss_verify_stream.h"
 #include "../utils.h"
 
 #ifdef XMSSMT
     #define XMSS_PARSE_OID xmssmt_parse_oid
-    #define XMSS_SIGN_OPEN xmssmt_sign_open
+    #define XMSS_VERIFY_BEGIN xmssmt_core_verify_begin
+    #define XMSS_VERIFY_SIG_UPDATE xmssmt_core_verify_sig_update
+    #define XMSS_VERIFY_MSG_UPDATE xmssmt_core_verify_msg_update
+    #define XMSS_VERIFY_MSG_FINAL xmssmt_core_verify_msg_final
+    #define XMSS_VERIFY_FINISH xmssmt_core_verify_finish
 #else
     #define XMSS_PARSE_OID xmss_parse_oid
-    #define XMSS_SIGN_OPEN xmss_sign_open
+    #define XMSS_VERIFY_BEGIN xmss_core_verify_begin
+    #define XMSS_VERIFY_SIG_UPDATE xmss_core_verify_sig_update
+    #define XMSS_VERIFY_MSG_UPDATE xmss_core_verify_msg_update
+    #define XMSS_VERIFY_MSG_FINAL xmss_core_verify_msg_final
+    #define XMSS_VERIFY_FINISH xmss_core_verify_finish
 #endif
 
+/* Input that cannot be mapped is read and verified in parts of this size. */
+#define CHUNK_BYTES 65536
+
+/**
+ * Maps a regular file into memory for a single sequential pass, so that it
+ * is read straight from the page cache. Returns NULL for anything else,
+ * such as pipes or empty files, which then have to be read.
+ */
+static unsigned char *map_file(FILE *f, unsigned long long *len)
+{
+    struct stat st;
+    void *map;
+
+    if (fstat(fileno(f), &st) || !S_ISREG(st.st_mode) || st.st_size == 0) {
+        return NULL;
+    }
+    map = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fileno(f), 0);
+    if (map == MAP_FAILED) {
+        return NULL;
+    }
+    madvise(map, st.st_size, MADV_SEQUENTIAL);
+    *len = st.st_size;
+    return map;
+}
+
+/**
+ * Verifies a detached signature from sig_file on the message in m_file.
+ * After the start of the signature, the message is hashed as it is read,
+ * and then the rest of the signature is processed.
+ */
+static int open_detached(const xmss_params *params, xmss_verify_stream *state,
+                         FILE *sig_file, FILE *m_file)
+{
+    unsigned char chunk[CHUNK_BYTES];
+    unsigned char *sig = malloc(params->sig_bytes + 1);
+    unsigned long long header = params->index_bytes + params->n;
+    unsigned long long mlen;
+    unsigned char *m;
+    size_t len;
+
+    /* Reading one byte more detects signature files that are too long. */
+    if (sig == NULL ||
+        fread(sig, 1, params->sig_bytes + 1, sig_file) != params->sig_bytes) {
+        free(sig);
+        XMSS_VERIFY_FINISH(state);
+        return -1;
+    }
+    XMSS_VERIFY_SIG_UPDATE(state, sig, header);
+    m = map_file(m_file, &mlen);
+    if (m != NULL) {
+        XMSS_VERIFY_MSG_UPDATE(state, m, mlen);
+        munmap(m, mlen);
+    }
+    else {
+        while ((len = fread(chunk, 1, CHUNK_BYTES, m_file)) > 0) {
+            XMSS_VERIFY_MSG_UPDATE(state, chunk, len);
+        }
+    }
+    XMSS_VERIFY_MSG_FINAL(state);
+    XMSS_VERIFY_SIG_UPDATE(state, sig + header, params->sig_bytes - header);
+
+    free(sig);
+    return XMSS_VERIFY_FINISH(state);
+}
+
 int main(int argc, char **argv) {
     FILE *keypair_file;
     FILE *sm_file;
+    FILE *m_file = NULL;
 
     xmss_params params;
     uint32_t oid = 0;
     uint8_t buffer[XMSS_OID_LEN];
     int parse_oid_result;
 
+    xmss_verify_stream state;
+    unsigned char chunk[CHUNK_BYTES];
+    unsigned char *sm;
     unsigned long long smlen;
+    unsigned long long offset = 0;
+    size_t len;
+    size_t part;
+    int detached = 0;
     int ret;
 
+    if (argc == 5 && !strcmp(argv[1], "--detached")) {
+        detached = 1;
+        argc -= 2;
+        argv++;
+    }
     if (argc != 3) {
         fprintf(stderr, "Expected keypair and signature + message filenames "
-                        "as two parameters.\n"
+                        "as two parameters, or --detached followed by the "
+                        "keypair, signature and message filenames.\n"
                         "Keypair file needs only to contain the public key.\n"
                         "The return code 0 indicates verification success.\n");
         return -1;
@@ -46,9 +136,15 @@ int main(int argc, char **argv) {
         return -1;
     }
 
-    /* Find out the message length. */
-    fseek(sm_file, 0, SEEK_END);
-    smlen = ftell(sm_file);
+    if (detached) {
+        m_file = fopen(argv[3], "rb");
+        if (m_file == NULL) {
+            fprintf(stderr, "Could not open message file.\n");
+            fclose(keypair_file);
+            fclose(sm_file);
+            return -1;
+        }
+    }
 
     fread(&buffer, 1, XMSS_OID_LEN, keypair_file);
     oid = (uint32_t)bytes_to_ull(buffer, XMSS_OID_LEN);
@@ -57,20 +153,55 @@ int main(int argc, char **argv) {
         fprintf(stderr, "Error parsing oid.\n");
         fclose(keypair_file);
         fclose(sm_file);
+        if (m_file != NULL) {
+            fclose(m_file);
+        }
         return parse_oid_result;
     }
 
     unsigned char pk[XMSS_OID_LEN + params.pk_bytes];
-    unsigned char *sm = malloc(smlen);
-    unsigned char *m = malloc(smlen);
-    unsigned long long mlen;
 
     fseek(keypair_file, 0, SEEK_SET);
-    fseek(sm_file, 0, SEEK_SET);
     fread(pk, 1, XMSS_OID_LEN + params.pk_bytes, keypair_file);
-    fread(sm, 1, smlen, sm_file);
 
-    ret = XMSS_SIGN_OPEN(m, &mlen, sm, smlen, pk);
+    if (XMSS_VERIFY_BEGIN(&params, &state, pk + XMSS_OID_LEN)) {
+        fprintf(stderr, "Could not start verification.\n");
+        fclose(keypair_file);
+        fclose(sm_file);
+        if (m_file != NULL) {
+            fclose(m_file);
+        }
+        return -1;
+    }
+
+    if (detached) {
+        ret = open_detached(&params, &state, sm_file, m_file);
+        fclose(m_file);
+    }
+    else if ((sm = map_file(sm_file, &smlen)) != NULL) {
+        part = params.sig_bytes < smlen ? params.sig_bytes : smlen;
+        XMSS_VERIFY_SIG_UPDATE(&state, sm, part);
+        XMSS_VERIFY_MSG_UPDATE(&state, sm + part, smlen - part);
+        ret = XMSS_VERIFY_FINISH(&state);
+        munmap(sm, smlen);
+    }
+    else {
+        /* The signature and the message are processed as they are read,
+           so that the signed message never has to be in memory at once. */
+        while ((len = fread(chunk, 1, CHUNK_BYTES, sm_file)) > 0) {
+            part = 0;
+            if (offset < params.sig_bytes) {
+                part = params.sig_bytes - offset < len
+                       ? params.sig_bytes - offset : len;
+                XMSS_VERIFY_SIG_UPDATE(&state, chunk, part);
+            }
+            if (part < len) {
+                XMSS_VERIFY_MSG_UPDATE(&state, chunk + part, len - part);
+            }
+            offset += len;
+        }
+        ret = XMSS_VERIFY_FINISH(&state);
+    }
 
     if (ret) {
         printf("Verification failed!\n");
@@ -82,8 +213,5 @@ int main(int argc, char **argv) {
     fclose(keypair_file);
     fclose(sm_file);
 
-    free(m);
-    free(sm);
-
     return ret;
 }
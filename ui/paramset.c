@@ -0,0 +1,181 @@
+/*
+ * Chooses a parameter set. Calibrates the cost model of xmss_cost.h on this
+ * host, and lists the sets that meet the given limits, fastest first, with
+ * their predicted keygen, sign and verify times and their sizes.
+ *
+ * Usage: paramset [options]
+ *   -s signatures  signatures a key must make (default: 2^20 - 1)
+ *   -b bytes       largest signature
+ *   -S bytes       largest secret key, including any BDS state
+ *   -K seconds     longest keygen
+ *   -n bytes       smallest n (default: 32)
+ *   -m bytes       message length (default: 32)
+ *   -o order       sign, verify, keygen or size (default: sign)
+ *   -c count       sets to list (default: 20)
+ *   -k rank        write a keypair of the set at this rank to stdout
+ *
+ * Sets without an RFC 8391 OID get a private-use OID, which the other tools
+ * accept as well. With -k, the list is written to stderr.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "../params.h"
+#include "../xmss.h"
+#include "../xmss_cost.h"
+
+#define CALIBRATE_RUNS 200
+
+static const char *hash_names[] = {"SHA2", "SHAKE128", "SHAKE256"};
+
+static const char *order_names[] = {"sign", "verify", "keygen", "size"};
+
+static void usage(void)
+{
+    fprintf(stderr, "Usage: paramset [-s signatures] [-b max_sig_bytes] "
+                    "[-S max_sk_bytes] [-K max_keygen_seconds]\n"
+                    "                [-n min_n] [-m msg_bytes] "
+                    "[-o sign|verify|keygen|size] [-c count] [-k rank]\n");
+}
+
+static void print_estimates(FILE *f, const xmss_cost_estimate *estimates,
+                            unsigned int count, int bds)
+{
+    const xmss_params *p;
+    const char *name;
+    char k[4];
+    unsigned int i;
+
+    fprintf(f, "%4s %-10s %-26s %-8s %3s %3s %3s %4s %3s "
+               "%12s %12s %12s %8s %10s\n",
+            "rank", "oid", "name", "hash", "n", "h", "d", "w", "k",
+            "keygen (s)", "sign (us)", "verify (us)", "sig", "sk");
+    for (i = 0; i < count; i++) {
+        p = &estimates[i].params;
+        name = xmss_params_name(estimates[i].oid, estimates[i].mt);
+        /* bds_k only matters to a core that keeps BDS state. */
+        snprintf(k, sizeof(k), "%u", p->bds_k);
+        fprintf(f, "%4u 0x%08x %-26s %-8s %3u %3u %3u %4u %3s "
+                   "%12.3f %12.1f %12.1f %8u %10llu\n",
+                i + 1, estimates[i].oid, name ? name : "-",
+                hash_names[p->func], p->n, p->full_height, p->d, p->wots_w,
+                bds ? k : "-", estimates[i].keygen_ns / 1e9,
+                estimates[i].sign_ns / 1e3, estimates[i].verify_ns / 1e3,
+                p->sig_bytes, p->sk_bytes);
+    }
+}
+
+int main(int argc, char **argv)
+{
+    xmss_cost_model model;
+    xmss_cost_limits limits;
+    xmss_cost_estimate *estimates;
+    unsigned int count = 20;
+    unsigned int rank = 0;
+    int found;
+    int i;
+    int j;
+
+    memset(&limits, 0, sizeof(limits));
+    limits.signatures = (1ULL << 20) - 1;
+    limits.min_n = 32;
+    limits.mlen = 32;
+    limits.order = XMSS_COST_BY_SIGN;
+
+    for (i = 1; i < argc; i += 2) {
+        if (i + 1 >= argc || strlen(argv[i]) != 2 || argv[i][0] != '-') {
+            usage();
+            return -1;
+        }
+        switch (argv[i][1]) {
+            case 's':
+                limits.signatures = strtoull(argv[i + 1], NULL, 10);
+                break;
+            case 'b':
+                limits.max_sig_bytes = strtoull(argv[i + 1], NULL, 10);
+                break;
+            case 'S':
+                limits.max_sk_bytes = strtoull(argv[i + 1], NULL, 10);
+                break;
+            case 'K':
+                limits.max_keygen_ns = atof(argv[i + 1]) * 1e9;
+                break;
+            case 'n':
+                limits.min_n = atoi(argv[i + 1]);
+                break;
+            case 'm':
+                limits.mlen = strtoull(argv[i + 1], NULL, 10);
+                break;
+            case 'o':
+                for (j = 0; j < 4; j++) {
+                    if (!strcmp(argv[i + 1], order_names[j])) {
+                        limits.order = (xmss_cost_order)j;
+                        break;
+                    }
+                }
+                if (j == 4) {
+                    usage();
+                    return -1;
+                }
+                break;
+            case 'c':
+                count = atoi(argv[i + 1]);
+                break;
+            case 'k':
+                rank = atoi(argv[i + 1]);
+                break;
+            default:
+                usage();
+                return -1;
+        }
+    }
+    if (count < rank) {
+        count = rank;
+    }
+
+    if (xmss_cost_calibrate(&model, CALIBRATE_RUNS)) {
+        fprintf(stderr, "Could not calibrate the cost model.\n");
+        return -1;
+    }
+    estimates = malloc(count * sizeof(xmss_cost_estimate));
+    if (estimates == NULL) {
+        return -1;
+    }
+    found = xmss_cost_enumerate(estimates, count, &model, &limits);
+    if (found < 0) {
+        fprintf(stderr, "Could not enumerate the parameter sets.\n");
+        free(estimates);
+        return -1;
+    }
+
+    print_estimates(rank ? stderr : stdout, estimates, found, model.bds);
+
+    if (rank) {
+        if (rank > (unsigned int)found) {
+            fprintf(stderr, "There is no set at rank %u.\n", rank);
+            free(estimates);
+            return -1;
+        }
+        const xmss_cost_estimate *e = &estimates[rank - 1];
+        unsigned char pk[XMSS_OID_LEN + e->params.pk_bytes];
+        unsigned char *sk = malloc(XMSS_OID_LEN + e->params.sk_bytes);
+
+        if (sk == NULL ||
+            (e->mt ? xmssmt_keypair(pk, sk, e->oid)
+                   : xmss_keypair(pk, sk, e->oid))) {
+            fprintf(stderr, "Could not generate a keypair.\n");
+            free(sk);
+            free(estimates);
+            return -1;
+        }
+        fwrite(pk, 1, XMSS_OID_LEN + e->params.pk_bytes, stdout);
+        fwrite(sk, 1, XMSS_OID_LEN + e->params.sk_bytes, stdout);
+        fclose(stdout);
+        free(sk);
+    }
+
+    free(estimates);
+    return 0;
+}
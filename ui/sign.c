@@ -1,18 +1,457 @@
+#include <pthread.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
 
 #include "../params.h"
 #include "../xmss.h"
+#include "../xmss_core_steps.h"
+#include "../xmss_detached.h"
 #include "../utils.h"
 
 #ifdef XMSSMT
     #define XMSS_PARSE_OID xmssmt_parse_oid
     #define XMSS_SIGN xmssmt_sign
+    #define XMSS_SIGN_MSG_INIT xmssmt_core_sign_msg_init
+    #define XMSS_SIGN_MSG_UPDATE xmssmt_core_sign_msg_update
+    #define XMSS_SIGN_MSG_FINAL xmssmt_core_sign_msg_final
+    #define XMSS_SIGN_FINISH xmssmt_core_sign_finish
+    #define XMSS_SIGN_DETACHED xmssmt_core_sign_detached
 #else
     #define XMSS_PARSE_OID xmss_parse_oid
     #define XMSS_SIGN xmss_sign
+    #define XMSS_SIGN_MSG_INIT xmss_core_sign_msg_init
+    #define XMSS_SIGN_MSG_UPDATE xmss_core_sign_msg_update
+    #define XMSS_SIGN_MSG_FINAL xmss_core_sign_msg_final
+    #define XMSS_SIGN_FINISH xmss_core_sign_finish
+    #define XMSS_SIGN_DETACHED xmss_core_sign_detached
 #endif
 
+/* Input that cannot be mapped is read in parts of this size. */
+#define CHUNK_BYTES 65536
+
+/* In batch mode, each signature is written next to its message. */
+#define SIG_SUFFIX ".sig"
+
+typedef struct {
+    const xmss_params *params;
+    const unsigned char *sk;
+    unsigned long long first;
+    char **paths;
+    int *results;
+    unsigned long count;
+    unsigned long next;
+    pthread_mutex_t lock;
+} batch;
+
+/**
+ * Maps a regular file into memory for a single sequential pass, so that it
+ * is read straight from the page cache. Returns NULL for anything else,
+ * such as pipes or empty files, which then have to be read.
+ */
+static unsigned char *map_file(FILE *f, unsigned long long *len)
+{
+    struct stat st;
+    void *map;
+
+    if (fstat(fileno(f), &st) || !S_ISREG(st.st_mode) || st.st_size == 0) {
+        return NULL;
+    }
+    map = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fileno(f), 0);
+    if (map == MAP_FAILED) {
+        return NULL;
+    }
+    madvise(map, st.st_size, MADV_SEQUENTIAL);
+    *len = st.st_size;
+    return map;
+}
+
+/**
+ * Appends len bytes to the buffer *buf of *buflen bytes, growing it as
+ * needed. Returns -1 when out of memory.
+ */
+static int append(unsigned char **buf, unsigned long long *buflen,
+                  unsigned long long *bufsize,
+                  const unsigned char *in, size_t len)
+{
+    unsigned char *grown;
+
+    if (*buflen + len > *bufsize) {
+        *bufsize = 2 * (*buflen + len);
+        grown = realloc(*buf, *bufsize);
+        if (grown == NULL) {
+            return -1;
+        }
+        *buf = grown;
+    }
+    memcpy(*buf + *buflen, in, len);
+    *buflen += len;
+    return 0;
+}
+
+/* Writes sk back over the secret key that was last read from the keypair
+   file, and waits until it is on stable storage. */
+static int persist_sk(FILE *keypair_file, const unsigned char *sk,
+                      unsigned long long sk_bytes)
+{
+    if (fseek(keypair_file, -((long int)sk_bytes), SEEK_CUR) ||
+        fwrite(sk, 1, sk_bytes, keypair_file) != sk_bytes ||
+        fflush(keypair_file)) {
+        return -1;
+    }
+    return fdatasync(fileno(keypair_file));
+}
+
+/**
+ * Signs the message from m_file. A mapped message is hashed in one pass and
+ * copied to stdout behind the signature unless the signature is detached.
+ * Other input is hashed as it is read; only when the message has to be
+ * output behind the signature, it is kept in memory until then.
+ * This requires a key without state beyond its index, as the step-wise
+ * signer only keeps the index up to date.
+ */
+static int sign_stream(const xmss_params *params, FILE *keypair_file,
+                       FILE *m_file, unsigned char *sk, int detached)
+{
+    xmss_sign_state state;
+    unsigned char chunk[CHUNK_BYTES];
+    unsigned char *sig = malloc(params->sig_bytes);
+    unsigned char *m;
+    unsigned long long mlen = 0;
+    unsigned long long msize = 0;
+    int mapped;
+    size_t len;
+    int ret = -1;
+
+    m = map_file(m_file, &mlen);
+    mapped = m != NULL;
+
+    if (sig == NULL || XMSS_SIGN_MSG_INIT(params, &state, sk, sig)) {
+        goto out;
+    }
+    if (mapped) {
+        if (XMSS_SIGN_MSG_UPDATE(&state, m, mlen)) {
+            XMSS_SIGN_MSG_FINAL(&state);
+            goto out;
+        }
+    }
+    else {
+        while ((len = fread(chunk, 1, CHUNK_BYTES, m_file)) > 0) {
+            if (XMSS_SIGN_MSG_UPDATE(&state, chunk, len) ||
+                (!detached && append(&m, &mlen, &msize, chunk, len))) {
+                XMSS_SIGN_MSG_FINAL(&state);
+                goto out;
+            }
+        }
+        /* A read error would otherwise sign a truncated message. */
+        if (ferror(m_file)) {
+            fprintf(stderr, "Could not read the message.\n");
+            XMSS_SIGN_MSG_FINAL(&state);
+            goto out;
+        }
+    }
+    if (XMSS_SIGN_MSG_FINAL(&state)) {
+        goto out;
+    }
+    XMSS_SIGN_FINISH(&state);
+
+    /* The updated key is stored before the signature is released. */
+    if (persist_sk(keypair_file, sk, params->sk_bytes)) {
+        fprintf(stderr, "Could not store the updated keypair.\n");
+        goto out;
+    }
+    fwrite(sig, 1, params->sig_bytes, stdout);
+    if (!detached && mlen > 0) {
+        fwrite(m, 1, mlen, stdout);
+    }
+    ret = 0;
+
+out:
+    if (mapped) {
+        munmap(m, mlen);
+    }
+    else {
+        free(m);
+    }
+    free(sig);
+    return ret;
+}
+
+/* Maps or reads the message file at path. */
+static int load_message(const char *path, unsigned char **m,
+                        unsigned long long *mlen, int *mapped)
+{
+    unsigned char chunk[CHUNK_BYTES];
+    unsigned long long msize = 0;
+    FILE *f = fopen(path, "rb");
+    size_t len;
+    int ret = 0;
+
+    *mlen = 0;
+    if (f == NULL) {
+        return -1;
+    }
+    *m = map_file(f, mlen);
+    *mapped = *m != NULL;
+    if (!*mapped) {
+        while (ret == 0 && (len = fread(chunk, 1, CHUNK_BYTES, f)) > 0) {
+            ret = append(m, mlen, &msize, chunk, len);
+        }
+        if (ret || ferror(f)) {
+            free(*m);
+            ret = -1;
+        }
+    }
+    fclose(f);
+    return ret;
+}
+
+static void unload_message(unsigned char *m, unsigned long long mlen,
+                           int mapped)
+{
+    if (mapped) {
+        munmap(m, mlen);
+    }
+    else {
+        free(m);
+    }
+}
+
+/* Writes the signature of the message at path to path SIG_SUFFIX. */
+static int write_sig(const char *path, const unsigned char *sig,
+                     unsigned long long sig_bytes)
+{
+    char *sig_path = malloc(strlen(path) + sizeof(SIG_SUFFIX));
+    FILE *f;
+    int ret = -1;
+
+    if (sig_path == NULL) {
+        return -1;
+    }
+    sprintf(sig_path, "%s%s", path, SIG_SUFFIX);
+    f = fopen(sig_path, "wb");
+    if (f != NULL) {
+        if (fwrite(sig, 1, sig_bytes, f) == sig_bytes) {
+            ret = 0;
+        }
+        if (fclose(f)) {
+            ret = -1;
+        }
+    }
+    free(sig_path);
+    return ret;
+}
+
+/**
+ * Signs the messages of a batch with the indices that were reserved for it:
+ * message i is signed with index b->first + i, on a private copy of the key.
+ * The workers therefore never wait for each other, other than to take the
+ * next message.
+ */
+static void *batch_worker(void *arg)
+{
+    batch *b = arg;
+    const xmss_params *params = b->params;
+    unsigned char sk[params->sk_bytes];
+    unsigned char *sig = malloc(params->sig_bytes);
+    unsigned char *m;
+    unsigned long long mlen;
+    unsigned long i;
+    int mapped;
+
+    for (;;) {
+        pthread_mutex_lock(&b->lock);
+        i = b->next++;
+        pthread_mutex_unlock(&b->lock);
+        if (i >= b->count) {
+            break;
+        }
+        b->results[i] = -1;
+        if (sig == NULL || load_message(b->paths[i], &m, &mlen, &mapped)) {
+            continue;
+        }
+        memcpy(sk, b->sk, params->sk_bytes);
+        ull_to_bytes(sk, params->index_bytes, b->first + i);
+        if (!XMSS_SIGN_DETACHED(params, sk, sig, m, mlen)) {
+            b->results[i] = write_sig(b->paths[i], sig, params->sig_bytes);
+        }
+        unload_message(m, mlen, mapped);
+    }
+
+    memset(sk, 0, params->sk_bytes);
+    free(sig);
+    return NULL;
+}
+
+/**
+ * Signs every message file listed in list_file, one path per line, with the
+ * key sk (with OID) that was just read from keypair_file. The signatures are
+ * detached and written to the path of each message with SIG_SUFFIX.
+ *
+ * For keys without state beyond the index, the indices of the whole batch
+ * are reserved up front: the key with the index after the batch is stored
+ * and synced once, and the messages are then signed in parallel. A crash
+ * thus never leads to an index being reused, only to reserved indices that
+ * remain unused, as do those of messages that cannot be read.
+ * Keys of the BDS core have to be updated by every signature in turn; their
+ * messages are signed one by one in memory, and the signatures are only
+ * written after the final key has been stored and synced.
+ */
+static int sign_batch(const xmss_params *params, FILE *keypair_file,
+                      FILE *list_file, unsigned char *sk, long threadcount)
+{
+    batch b;
+    pthread_t *threads = NULL;
+    long started = 0;
+    long t;
+    struct timespec start, stop;
+    double seconds;
+    unsigned long cap = 0;
+    unsigned long failed = 0;
+    unsigned long i;
+    unsigned long long idx;
+    unsigned long long mlen;
+    unsigned long long smlen;
+    unsigned char *sigs = NULL;
+    unsigned char *sm;
+    unsigned char *m;
+    char **grown;
+    char *line = NULL;
+    size_t linecap = 0;
+    ssize_t len;
+    int mapped;
+    int ret = -1;
+
+    memset(&b, 0, sizeof(batch));
+    b.params = params;
+    b.sk = sk + XMSS_OID_LEN;
+
+    while ((len = getline(&line, &linecap, list_file)) >= 0) {
+        while (len > 0 && (line[len - 1] == '\n' || line[len - 1] == '\r')) {
+            line[--len] = '\0';
+        }
+        if (len == 0) {
+            continue;
+        }
+        if (b.count == cap) {
+            cap = cap ? 2 * cap : 1024;
+            grown = realloc(b.paths, cap * sizeof(char *));
+            if (grown == NULL) {
+                break;
+            }
+            b.paths = grown;
+        }
+        b.paths[b.count] = strdup(line);
+        if (b.paths[b.count] == NULL) {
+            break;
+        }
+        b.count++;
+    }
+    b.results = malloc((b.count ? b.count : 1) * sizeof(int));
+    if (len >= 0 || ferror(list_file) || b.results == NULL) {
+        fprintf(stderr, "Could not read the list of message files.\n");
+        goto out;
+    }
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+
+    if (params->sk_bytes == params->index_bytes + 4*params->n) {
+        /* Reserve the indices of the batch before any of them is used. */
+        idx = bytes_to_ull(sk + XMSS_OID_LEN, params->index_bytes);
+        if (b.count > ((1ULL << params->full_height) - 1) - idx) {
+            fprintf(stderr, "Not enough indices left for %lu messages.\n",
+                    b.count);
+            goto out;
+        }
+        b.first = idx;
+        ull_to_bytes(sk + XMSS_OID_LEN, params->index_bytes, idx + b.count);
+        if (persist_sk(keypair_file, sk + XMSS_OID_LEN, params->sk_bytes)) {
+            fprintf(stderr, "Could not store the updated keypair.\n");
+            goto out;
+        }
+
+        threads = malloc(threadcount * sizeof(pthread_t));
+        pthread_mutex_init(&b.lock, NULL);
+        for (started = 0; threads != NULL && started < threadcount;
+             started++) {
+            if (pthread_create(&threads[started], NULL, batch_worker, &b)) {
+                break;
+            }
+        }
+        /* If no thread could be started, do the work here. */
+        if (started == 0) {
+            batch_worker(&b);
+        }
+        for (t = 0; t < started; t++) {
+            pthread_join(threads[t], NULL);
+        }
+        pthread_mutex_destroy(&b.lock);
+    }
+    else {
+        sigs = malloc((b.count ? b.count : 1) * params->sig_bytes);
+        if (sigs == NULL) {
+            fprintf(stderr, "Could not allocate the signatures.\n");
+            goto out;
+        }
+        for (i = 0; i < b.count; i++) {
+            b.results[i] = -1;
+            if (load_message(b.paths[i], &m, &mlen, &mapped)) {
+                continue;
+            }
+            sm = malloc(params->sig_bytes + mlen);
+            if (sm != NULL && !XMSS_SIGN(sk, sm, &smlen, m, mlen)) {
+                memcpy(sigs + i*params->sig_bytes, sm, params->sig_bytes);
+                b.results[i] = 0;
+            }
+            free(sm);
+            unload_message(m, mlen, mapped);
+        }
+        /* Only release the signatures once the new state is durable. */
+        if (persist_sk(keypair_file, sk + XMSS_OID_LEN, params->sk_bytes)) {
+            fprintf(stderr, "Could not store the updated keypair.\n");
+            goto out;
+        }
+        for (i = 0; i < b.count; i++) {
+            if (!b.results[i]) {
+                b.results[i] = write_sig(b.paths[i],
+                                         sigs + i*params->sig_bytes,
+                                         params->sig_bytes);
+            }
+        }
+    }
+
+    clock_gettime(CLOCK_MONOTONIC, &stop);
+    seconds = (stop.tv_sec - start.tv_sec) +
+              (stop.tv_nsec - start.tv_nsec) / 1e9;
+
+    for (i = 0; i < b.count; i++) {
+        printf("%s: %s\n", b.paths[i], b.results[i] ? "FAILED" : "OK");
+        if (b.results[i]) {
+            failed++;
+        }
+    }
+    printf("Signed %lu files, %lu failed, in %.3f s with %ld threads: "
+           "%.1f files/s.\n",
+           b.count, failed, seconds, started ? started : 1,
+           seconds > 0 ? b.count / seconds : 0.0);
+    ret = failed ? -1 : 0;
+
+out:
+    for (i = 0; i < b.count; i++) {
+        free(b.paths[i]);
+    }
+    free(b.paths);
+    free(b.results);
+    free(sigs);
+    free(threads);
+    free(line);
+    return ret;
+}
+
 int main(int argc, char **argv) {
     FILE *keypair_file;
     FILE *m_file;
@@ -23,13 +462,46 @@ int main(int argc, char **argv) {
     uint8_t buffer[XMSS_OID_LEN];
     int parse_oid_result;
 
-    unsigned long long mlen;
+    unsigned char chunk[CHUNK_BYTES];
+    unsigned long long mlen = 0;
+    unsigned long long msize = 0;
+    int mapped;
+    size_t len;
+    int detached = 0;
+    int batch_mode = 0;
+    long threadcount = sysconf(_SC_NPROCESSORS_ONLN);
+    int ret;
 
-    if (argc != 3) {
+    /* Without a count of processors, sign batches on one thread. */
+    if (threadcount < 1) {
+        threadcount = 1;
+    }
+    if (argc == 4 && !strcmp(argv[1], "--detached")) {
+        detached = 1;
+        argc--;
+        argv++;
+    }
+    else if (argc >= 4 && !strcmp(argv[1], "--batch")) {
+        batch_mode = 1;
+        argc--;
+        argv++;
+        if (argc == 5 && !strcmp(argv[1], "-j")) {
+            threadcount = atol(argv[2]);
+            argc -= 2;
+            argv += 2;
+        }
+    }
+    if (argc != 3 || (batch_mode && threadcount < 1)) {
         fprintf(stderr, "Expected keypair and message filenames as two "
-                        "parameters.\n"
+                        "parameters, optionally preceded by --detached.\n"
                         "The keypair is updated with the changed state, "
-                        "and the message + signature is output via stdout.\n");
+                        "and the message + signature is output via stdout.\n"
+                        "With --detached, only the signature is output.\n"
+                        "With --batch [-j threads], the second filename is "
+                        "a list of message files, one per line, which are "
+                        "all signed with one update of the keypair. Their "
+                        "signatures are written to the message filenames "
+                        "with " SIG_SUFFIX " appended.\n");
         return -1;
     }
 
@@ -41,15 +513,12 @@ int main(int argc, char **argv) {
 
     m_file = fopen(argv[2], "rb");
     if (m_file == NULL) {
-        fprintf(stderr, "Could not open message file.\n");
+        fprintf(stderr, batch_mode ? "Could not open list of message files.\n"
+                                   : "Could not open message file.\n");
         fclose(keypair_file);
         return -1;
     }
 
-    /* Find out the message length. */
-    fseek(m_file, 0, SEEK_END);
-    mlen = ftell(m_file);
-
     /* Read the OID from the public key, as we need its length to seek past it */
     fread(&buffer, 1, XMSS_OID_LEN, keypair_file);
     /* The XMSS_OID_LEN bytes in buffer are a big-endian uint32. */
@@ -76,26 +545,61 @@ int main(int argc, char **argv) {
     }
 
     unsigned char sk[XMSS_OID_LEN + params.sk_bytes];
-    unsigned char *m = malloc(mlen);
-    unsigned char *sm = malloc(params.sig_bytes + mlen);
-    unsigned long long smlen;
 
     /* fseek back to start of sk. */
     fseek(keypair_file, -((long int)XMSS_OID_LEN), SEEK_CUR);
-    fseek(m_file, 0, SEEK_SET);
     fread(sk, 1, XMSS_OID_LEN + params.sk_bytes, keypair_file);
-    fread(m, 1, mlen, m_file);
+
+    if (batch_mode) {
+        ret = sign_batch(&params, keypair_file, m_file, sk, threadcount);
+        fclose(keypair_file);
+        fclose(m_file);
+        return ret;
+    }
+
+    /* Keys of the BDS core carry more state than the index. */
+    if (params.sk_bytes == params.index_bytes + 4*params.n) {
+        ret = sign_stream(&params, keypair_file, m_file, sk + XMSS_OID_LEN,
+                          detached);
+        fclose(keypair_file);
+        fclose(m_file);
+        return ret;
+    }
+
+    /* Otherwise, xmss[mt]_sign needs the whole message at once. */
+    unsigned char *m = map_file(m_file, &mlen);
+
+    mapped = m != NULL;
+    if (!mapped) {
+        while ((len = fread(chunk, 1, CHUNK_BYTES, m_file)) > 0) {
+            if (append(&m, &mlen, &msize, chunk, len)) {
+                fprintf(stderr, "Could not read message file.\n");
+                free(m);
+                fclose(keypair_file);
+                fclose(m_file);
+                return -1;
+            }
+        }
+    }
+
+    unsigned char *sm = malloc(params.sig_bytes + mlen);
+    unsigned long long smlen;
 
     XMSS_SIGN(sk, sm, &smlen, m, mlen);
 
     fseek(keypair_file, -((long int)params.sk_bytes), SEEK_CUR);
     fwrite(sk + XMSS_OID_LEN, 1, params.sk_bytes, keypair_file);
-    fwrite(sm, 1, smlen, stdout);
+    fwrite(sm, 1, detached ? params.sig_bytes : smlen, stdout);
 
     fclose(keypair_file);
     fclose(m_file);
 
-    free(m);
+    if (mapped) {
+        munmap(m, mlen);
+    }
+    else {
+        free(m);
+    }
     free(sm);
 
     return 0;
@@ -0,0 +1,418 @@
+/*
+ * Resident signer. Loads a keypair file once, keeps the secret key in memory
+ * and serves sign requests over a local Unix domain socket.
+ *
+ * Every request is a 4-byte big-endian message length followed by the
+ * message. Every response is a 4-byte big-endian length followed by the
+ * signature + message, as produced by xmss_sign; a length of 0 signals that
+ * the request could not be served. Clients may pipeline any number of
+ * requests on one connection; responses are returned in request order.
+ * A client that shuts down its side of the connection still receives the
+ * responses to all complete requests it has sent; the connection is closed
+ * once they are written. Per client, input is only read while less than one
+ * request of the maximum length is buffered.
+ *
+ * All requests that are available at the same time are signed as one batch.
+ * The updated state is written back to the keypair file and synced before
+ * any signature of that batch is released, so a crash can never lead to an
+ * index being reused. The durability lag is thus bounded by one batch, and
+ * the cost of the sync is shared by all requests in it.
+ */
+
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include "../params.h"
+#include "../xmss.h"
+#include "../utils.h"
+
+#ifdef XMSSMT
+    #define XMSS_PARSE_OID xmssmt_parse_oid
+    #define XMSS_SIGN xmssmt_sign
+#else
+    #define XMSS_PARSE_OID xmss_parse_oid
+    #define XMSS_SIGN xmss_sign
+#endif
+
+#define SIGND_MAX_CLIENTS 64
+#define SIGND_MAX_BATCH 256
+#define SIGND_MAX_MLEN (1 << 20)
+#define SIGND_FRAME_LEN 4
+#define SIGND_MAX_IN (SIGND_FRAME_LEN + SIGND_MAX_MLEN)
+#define SIGND_READ_LEN 65536
+
+typedef struct {
+    int fd;
+    /* Set once the client has shut down its side of the connection. */
+    int closing;
+    unsigned char *in;
+    unsigned long long in_len;
+    unsigned long long in_cap;
+    unsigned char *out;
+    unsigned long long out_len;
+    unsigned long long out_pos;
+    unsigned long long out_cap;
+} client;
+
+typedef struct {
+    client *c;
+    const unsigned char *m;
+    unsigned long long mlen;
+} request;
+
+static int reserve(unsigned char **buf, unsigned long long *cap,
+                   unsigned long long len)
+{
+    unsigned char *tmp;
+    unsigned long long newcap = *cap ? *cap : 4096;
+
+    if (len <= *cap) {
+        return 0;
+    }
+    while (newcap < len) {
+        newcap *= 2;
+    }
+    tmp = realloc(*buf, newcap);
+    if (tmp == NULL) {
+        return -1;
+    }
+    *buf = tmp;
+    *cap = newcap;
+    return 0;
+}
+
+static int queue_response(client *c, const unsigned char *sm,
+                          unsigned long long smlen)
+{
+    if (reserve(&c->out, &c->out_cap,
+                c->out_len + SIGND_FRAME_LEN + smlen)) {
+        return -1;
+    }
+    ull_to_bytes(c->out + c->out_len, SIGND_FRAME_LEN, smlen);
+    memcpy(c->out + c->out_len + SIGND_FRAME_LEN, sm, smlen);
+    c->out_len += SIGND_FRAME_LEN + smlen;
+    return 0;
+}
+
+static void drop_client(client *c)
+{
+    close(c->fd);
+    free(c->in);
+    free(c->out);
+    memset(c, 0, sizeof(client));
+    c->fd = -1;
+}
+
+/* Returns 1 if the input buffer of c starts with a complete request. */
+static int complete_request(const client *c)
+{
+    return c->in_len >= SIGND_FRAME_LEN &&
+           c->in_len - SIGND_FRAME_LEN >= bytes_to_ull(c->in, SIGND_FRAME_LEN);
+}
+
+/* Writes the secret key back to the keypair file and waits until it is on
+   stable storage. Returns -1 if this cannot be guaranteed. */
+static int persist_sk(int fd, long int sk_offset,
+                      const unsigned char *sk, unsigned long long sk_bytes)
+{
+    unsigned long long written = 0;
+    ssize_t ret;
+
+    while (written < sk_bytes) {
+        ret = pwrite(fd, sk + written, sk_bytes - written,
+                     sk_offset + written);
+        if (ret < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return -1;
+        }
+        written += ret;
+    }
+    return fdatasync(fd);
+}
+
+/* Moves all complete frames from the input buffer of c to the batch. */
+static int collect_requests(client *c, request *batch, unsigned int *count)
+{
+    unsigned long long pos = 0;
+    unsigned long long mlen;
+
+    while (*count < SIGND_MAX_BATCH && c->in_len - pos >= SIGND_FRAME_LEN) {
+        mlen = bytes_to_ull(c->in + pos, SIGND_FRAME_LEN);
+        if (mlen > SIGND_MAX_MLEN) {
+            return -1;
+        }
+        if (c->in_len - pos - SIGND_FRAME_LEN < mlen) {
+            break;
+        }
+        batch[*count].c = c;
+        batch[*count].m = c->in + pos + SIGND_FRAME_LEN;
+        batch[*count].mlen = mlen;
+        (*count)++;
+        pos += SIGND_FRAME_LEN + mlen;
+    }
+    return 0;
+}
+
+/* Removes the frames that were handed out as part of the last batch. */
+static void consume_requests(client *c, const request *batch,
+                             unsigned int count)
+{
+    unsigned long long pos = 0;
+    unsigned int i;
+
+    for (i = 0; i < count; i++) {
+        if (batch[i].c == c) {
+            pos = (batch[i].m - c->in) + batch[i].mlen;
+        }
+    }
+    memmove(c->in, c->in + pos, c->in_len - pos);
+    c->in_len -= pos;
+}
+
+int main(int argc, char **argv)
+{
+    client clients[SIGND_MAX_CLIENTS];
+    struct pollfd pfds[SIGND_MAX_CLIENTS + 1];
+    request batch[SIGND_MAX_BATCH];
+    unsigned int batch_count = 0;
+    struct sockaddr_un addr;
+    int listen_fd;
+    int keypair_fd;
+    int fd;
+    unsigned int i, j;
+    unsigned long long len;
+    ssize_t ret;
+
+    xmss_params params;
+    uint32_t oid = 0;
+    uint8_t buffer[XMSS_OID_LEN];
+    long int sk_offset;
+    unsigned long long smlen;
+
+    if (argc != 3) {
+        fprintf(stderr, "Expected keypair filename and socket path as two "
+                        "parameters.\n"
+                        "The keypair is updated with the changed state after "
+                        "every batch of requests.\n");
+        return -1;
+    }
+
+    keypair_fd = open(argv[1], O_RDWR);
+    if (keypair_fd < 0) {
+        fprintf(stderr, "Could not open keypair file.\n");
+        return -1;
+    }
+
+    /* Read the OID from the public key, as we need its length to seek past it */
+    if (pread(keypair_fd, buffer, XMSS_OID_LEN, 0) != XMSS_OID_LEN) {
+        fprintf(stderr, "Could not read public key oid.\n");
+        close(keypair_fd);
+        return -1;
+    }
+    oid = (uint32_t)bytes_to_ull(buffer, XMSS_OID_LEN);
+    if (XMSS_PARSE_OID(&params, oid)) {
+        fprintf(stderr, "Error parsing public key oid.\n");
+        close(keypair_fd);
+        return -1;
+    }
+    sk_offset = XMSS_OID_LEN + params.pk_bytes;
+
+    if (pread(keypair_fd, buffer, XMSS_OID_LEN, sk_offset) != XMSS_OID_LEN) {
+        fprintf(stderr, "Could not read secret key oid.\n");
+        close(keypair_fd);
+        return -1;
+    }
+    oid = (uint32_t)bytes_to_ull(buffer, XMSS_OID_LEN);
+    if (XMSS_PARSE_OID(&params, oid)) {
+        fprintf(stderr, "Error parsing secret key oid.\n");
+        close(keypair_fd);
+        return -1;
+    }
+
+    unsigned char sk[XMSS_OID_LEN + params.sk_bytes];
+    unsigned char *sm = malloc(params.sig_bytes + SIGND_MAX_MLEN);
+
+    if (sm == NULL ||
+        pread(keypair_fd, sk, XMSS_OID_LEN + params.sk_bytes, sk_offset)
+            != (ssize_t)(XMSS_OID_LEN + params.sk_bytes)) {
+        fprintf(stderr, "Could not read secret key.\n");
+        close(keypair_fd);
+        free(sm);
+        return -1;
+    }
+
+    if (strlen(argv[2]) >= sizeof(addr.sun_path)) {
+        fprintf(stderr, "Socket path too long.\n");
+        close(keypair_fd);
+        free(sm);
+        return -1;
+    }
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    strcpy(addr.sun_path, argv[2]);
+    unlink(argv[2]);
+
+    listen_fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (listen_fd < 0 ||
+        bind(listen_fd, (struct sockaddr *)&addr, sizeof(addr)) ||
+        listen(listen_fd, SIGND_MAX_CLIENTS)) {
+        fprintf(stderr, "Could not listen on socket.\n");
+        close(keypair_fd);
+        free(sm);
+        return -1;
+    }
+    fcntl(listen_fd, F_SETFL, O_NONBLOCK);
+    signal(SIGPIPE, SIG_IGN);
+
+    memset(clients, 0, sizeof(clients));
+    for (i = 0; i < SIGND_MAX_CLIENTS; i++) {
+        clients[i].fd = -1;
+    }
+
+    for (;;) {
+        pfds[0].fd = listen_fd;
+        pfds[0].events = POLLIN;
+        for (i = 0; i < SIGND_MAX_CLIENTS; i++) {
+            pfds[i + 1].fd = clients[i].fd;
+            pfds[i + 1].events = 0;
+            if (!clients[i].closing && clients[i].in_len < SIGND_MAX_IN) {
+                pfds[i + 1].events |= POLLIN;
+            }
+            if (clients[i].out_pos < clients[i].out_len) {
+                pfds[i + 1].events |= POLLOUT;
+            }
+        }
+        /* A full batch may have left complete requests behind; don't block. */
+        if (poll(pfds, SIGND_MAX_CLIENTS + 1,
+                 batch_count == SIGND_MAX_BATCH ? 0 : -1) < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            break;
+        }
+
+        if (pfds[0].revents & POLLIN) {
+            while ((fd = accept(listen_fd, NULL, NULL)) >= 0) {
+                for (i = 0; i < SIGND_MAX_CLIENTS; i++) {
+                    if (clients[i].fd == -1) {
+                        break;
+                    }
+                }
+                if (i == SIGND_MAX_CLIENTS) {
+                    close(fd);
+                    continue;
+                }
+                fcntl(fd, F_SETFL, O_NONBLOCK);
+                clients[i].fd = fd;
+            }
+        }
+
+        for (i = 0; i < SIGND_MAX_CLIENTS; i++) {
+            client *c = clients + i;
+
+            if (c->fd == -1 || pfds[i + 1].fd != c->fd) {
+                continue;
+            }
+            if (pfds[i + 1].revents & POLLOUT) {
+                ret = write(c->fd, c->out + c->out_pos,
+                            c->out_len - c->out_pos);
+                if (ret < 0 && errno != EAGAIN && errno != EINTR) {
+                    drop_client(c);
+                    continue;
+                }
+                if (ret > 0) {
+                    c->out_pos += ret;
+                }
+                if (c->out_pos == c->out_len) {
+                    c->out_pos = c->out_len = 0;
+                }
+            }
+            if ((pfds[i + 1].revents & (POLLIN | POLLHUP | POLLERR)) &&
+                !c->closing && c->in_len < SIGND_MAX_IN) {
+                len = SIGND_MAX_IN - c->in_len;
+                if (len > SIGND_READ_LEN) {
+                    len = SIGND_READ_LEN;
+                }
+                if (reserve(&c->in, &c->in_cap, c->in_len + len)) {
+                    drop_client(c);
+                    continue;
+                }
+                ret = read(c->fd, c->in + c->in_len, len);
+                if (ret == 0) {
+                    c->closing = 1;
+                }
+                else if (ret < 0 && errno != EAGAIN && errno != EINTR) {
+                    drop_client(c);
+                    continue;
+                }
+                else if (ret > 0) {
+                    c->in_len += ret;
+                }
+            }
+            /* The requests of a closing client are served before it is
+               dropped; an incomplete one can no longer be completed. */
+            if (c->closing && c->out_len == 0 && !complete_request(c)) {
+                drop_client(c);
+            }
+        }
+
+        /* Gather every complete request that is available right now. */
+        batch_count = 0;
+        for (i = 0; i < SIGND_MAX_CLIENTS; i++) {
+            if (clients[i].fd != -1 &&
+                collect_requests(clients + i, batch, &batch_count)) {
+                drop_client(clients + i);
+                /* Requests of this client may already be in the batch. */
+                for (j = 0; j < batch_count; j++) {
+                    if (batch[j].c == clients + i) {
+                        batch_count = j;
+                        break;
+                    }
+                }
+            }
+        }
+        if (batch_count == 0) {
+            continue;
+        }
+
+        /* Sign the batch. Each signature advances the in-memory state. */
+        for (i = 0; i < batch_count; i++) {
+            if (XMSS_SIGN(sk, sm, &smlen, batch[i].m, batch[i].mlen)) {
+                smlen = 0;
+            }
+            if (queue_response(batch[i].c, sm, smlen)) {
+                fprintf(stderr, "Out of memory.\n");
+                return -1;
+            }
+        }
+
+        /* Only release the signatures once the new state is durable. */
+        if (persist_sk(keypair_fd, sk_offset + XMSS_OID_LEN,
+                       sk + XMSS_OID_LEN, params.sk_bytes)) {
+            fprintf(stderr, "Could not persist state, shutting down.\n");
+            return -1;
+        }
+
+        for (i = 0; i < SIGND_MAX_CLIENTS; i++) {
+            if (clients[i].fd != -1) {
+                consume_requests(clients + i, batch, batch_count);
+            }
+        }
+    }
+
+    close(listen_fd);
+    close(keypair_fd);
+    free(sm);
+
+    return -1;
+}
@@ -0,0 +1,317 @@
+/*
+ * Bulk verifier. Verifies many signed files (signature + message, as written
+ * by sign) under one public key, which is loaded and parsed only once.
+ *
+ * The files are either listed in a manifest, one path per line, or are all
+ * regular files in a directory. They are verified by a pool of worker
+ * threads that share one verifier cache, so that nodes near the root are
+ * only authenticated once for all files. With -s, the roots of lower
+ * subtrees are cached as well: a file from a known bottom subtree is then
+ * accepted without checking its upper layers, so that it verifies even if
+ * those were altered. Every file is mapped and hashed in place. One line
+ * is printed per file, followed by the totals and the throughput; the
+ * return code is 0 only if all files verify.
+ */
+
+#include <dirent.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "../params.h"
+#include "../xmss_verify.h"
+#include "../utils.h"
+
+#ifdef XMSSMT
+    #define XMSS_PARSE_OID xmssmt_parse_oid
+    #define XMSS_SIGN_OPEN_CACHED xmssmt_core_sign_open_cached
+#else
+    #define XMSS_PARSE_OID xmss_parse_oid
+    #define XMSS_SIGN_OPEN_CACHED xmss_core_sign_open_cached
+#endif
+
+/* Levels of the top tree that are cached, and cached subtree roots with -s. */
+#define VERIFY_CACHE_LEVELS 8
+#define VERIFY_SUBTREE_SLOTS 1024
+
+typedef struct {
+    char *path;
+    unsigned long long size;
+    int result;
+} job;
+
+typedef struct {
+    const xmss_params *params;
+    xmss_verify_cache *cache;
+    const unsigned char *pk;
+    job *jobs;
+    unsigned long count;
+    unsigned long next;
+    pthread_mutex_t lock;
+} pool;
+
+static int add_job(job **jobs, unsigned long *count, unsigned long *cap,
+                   const char *path)
+{
+    job *tmp;
+
+    if (*count == *cap) {
+        *cap = *cap ? 2 * *cap : 1024;
+        tmp = realloc(*jobs, *cap * sizeof(job));
+        if (tmp == NULL) {
+            return -1;
+        }
+        *jobs = tmp;
+    }
+    (*jobs)[*count].path = strdup(path);
+    if ((*jobs)[*count].path == NULL) {
+        return -1;
+    }
+    (*jobs)[*count].size = 0;
+    (*jobs)[*count].result = -1;
+    (*count)++;
+    return 0;
+}
+
+/* Collects the regular files in a directory, or the paths in a manifest. */
+static int collect(const char *source, job **jobs, unsigned long *count)
+{
+    unsigned long cap = 0;
+    struct stat st;
+    struct dirent *entry;
+    DIR *dir;
+    FILE *manifest;
+    char *path;
+    char *line = NULL;
+    size_t linecap = 0;
+    ssize_t len;
+    int ret = 0;
+
+    if (stat(source, &st)) {
+        return -1;
+    }
+    if (S_ISDIR(st.st_mode)) {
+        dir = opendir(source);
+        if (dir == NULL) {
+            return -1;
+        }
+        while (ret == 0 && (entry = readdir(dir)) != NULL) {
+            path = malloc(strlen(source) + strlen(entry->d_name) + 2);
+            if (path == NULL) {
+                ret = -1;
+                break;
+            }
+            sprintf(path, "%s/%s", source, entry->d_name);
+            if (!stat(path, &st) && S_ISREG(st.st_mode)) {
+                ret = add_job(jobs, count, &cap, path);
+            }
+            free(path);
+        }
+        closedir(dir);
+        return ret;
+    }
+
+    manifest = fopen(source, "r");
+    if (manifest == NULL) {
+        return -1;
+    }
+    while (ret == 0 && (len = getline(&line, &linecap, manifest)) >= 0) {
+        while (len > 0 && (line[len - 1] == '\n' || line[len - 1] == '\r')) {
+            line[--len] = '\0';
+        }
+        if (len > 0) {
+            ret = add_job(jobs, count, &cap, line);
+        }
+    }
+    free(line);
+    fclose(manifest);
+    return ret;
+}
+
+/* Maps a signed file and verifies it in place. */
+static int verify_file(pool *p, job *j)
+{
+    struct stat st;
+    void *sm;
+    int fd;
+    int ret;
+
+    fd = open(j->path, O_RDONLY);
+    if (fd < 0) {
+        return -1;
+    }
+    if (fstat(fd, &st) || st.st_size == 0) {
+        close(fd);
+        return -1;
+    }
+    sm = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (sm == MAP_FAILED) {
+        return -1;
+    }
+    madvise(sm, st.st_size, MADV_SEQUENTIAL);
+    j->size = st.st_size;
+
+    ret = XMSS_SIGN_OPEN_CACHED(p->params, p->cache, sm, st.st_size, p->pk);
+
+    munmap(sm, st.st_size);
+    return ret;
+}
+
+static void *worker(void *arg)
+{
+    pool *p = arg;
+    unsigned long i;
+
+    for (;;) {
+        pthread_mutex_lock(&p->lock);
+        i = p->next++;
+        pthread_mutex_unlock(&p->lock);
+        if (i >= p->count) {
+            return NULL;
+        }
+        p->jobs[i].result = verify_file(p, &p->jobs[i]);
+    }
+}
+
+int main(int argc, char **argv)
+{
+    FILE *keypair_file;
+
+    xmss_params params;
+    xmss_verify_cache cache;
+    uint32_t oid = 0;
+    uint8_t buffer[XMSS_OID_LEN];
+    int parse_oid_result;
+
+    pool p;
+    pthread_t *threads;
+    long threadcount = sysconf(_SC_NPROCESSORS_ONLN);
+    long started;
+    struct timespec start, stop;
+    double seconds;
+    unsigned long long bytes = 0;
+    unsigned long failed = 0;
+    unsigned long i;
+    long t;
+    int trust_subtrees = 0;
+
+    /* Without a count of processors, verify on one thread. */
+    if (threadcount < 1) {
+        threadcount = 1;
+    }
+    while (argc > 3) {
+        if (argc > 4 && !strcmp(argv[1], "-j")) {
+            threadcount = atol(argv[2]);
+            argc -= 2;
+            argv += 2;
+        }
+        else if (!strcmp(argv[1], "-s")) {
+            trust_subtrees = 1;
+            argc--;
+            argv++;
+        }
+        else {
+            break;
+        }
+    }
+    if (argc != 3 || threadcount < 1) {
+        fprintf(stderr, "Expected keypair filename and a manifest or "
+                        "directory of signed files as two parameters, "
+                        "optionally preceded by -j and the number of "
+                        "threads, and by -s to skip the upper layers of "
+                        "files from an already verified subtree.\n"
+                        "Keypair file needs only to contain the public key.\n"
+                        "The return code 0 indicates that all files "
+                        "verified.\n");
+        return -1;
+    }
+
+    keypair_file = fopen(argv[1], "rb");
+    if (keypair_file == NULL) {
+        fprintf(stderr, "Could not open keypair file.\n");
+        return -1;
+    }
+
+    fread(&buffer, 1, XMSS_OID_LEN, keypair_file);
+    oid = (uint32_t)bytes_to_ull(buffer, XMSS_OID_LEN);
+    parse_oid_result = XMSS_PARSE_OID(&params, oid);
+    if (parse_oid_result != 0) {
+        fprintf(stderr, "Error parsing oid.\n");
+        fclose(keypair_file);
+        return parse_oid_result;
+    }
+
+    unsigned char pk[params.pk_bytes];
+
+    fread(pk, 1, params.pk_bytes, keypair_file);
+    fclose(keypair_file);
+
+    memset(&p, 0, sizeof(pool));
+    if (collect(argv[2], &p.jobs, &p.count)) {
+        fprintf(stderr, "Could not read the list of signed files.\n");
+        return -1;
+    }
+    if (xmss_verify_cache_init(&params, &cache,
+                               params.tree_height < VERIFY_CACHE_LEVELS
+                                   ? params.tree_height : VERIFY_CACHE_LEVELS,
+                               trust_subtrees ? VERIFY_SUBTREE_SLOTS : 0)) {
+        fprintf(stderr, "Could not allocate the verifier cache.\n");
+        return -1;
+    }
+    p.params = &params;
+    p.cache = &cache;
+    p.pk = pk;
+    pthread_mutex_init(&p.lock, NULL);
+
+    threads = malloc(threadcount * sizeof(pthread_t));
+    if (threads == NULL) {
+        fprintf(stderr, "Could not start the worker threads.\n");
+        return -1;
+    }
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (started = 0; started < threadcount; started++) {
+        if (pthread_create(&threads[started], NULL, worker, &p)) {
+            break;
+        }
+    }
+    /* If no thread could be started, do the work here. */
+    if (started == 0) {
+        worker(&p);
+    }
+    for (t = 0; t < started; t++) {
+        pthread_join(threads[t], NULL);
+    }
+    clock_gettime(CLOCK_MONOTONIC, &stop);
+    seconds = (stop.tv_sec - start.tv_sec) +
+              (stop.tv_nsec - start.tv_nsec) / 1e9;
+
+    for (i = 0; i < p.count; i++) {
+        printf("%s: %s\n", p.jobs[i].path,
+               p.jobs[i].result ? "FAILED" : "OK");
+        if (p.jobs[i].result) {
+            failed++;
+        }
+        bytes += p.jobs[i].size;
+        free(p.jobs[i].path);
+    }
+    printf("Verified %lu files, %lu failed, %llu bytes in %.3f s "
+           "with %ld threads: %.1f files/s, %.1f MB/s.\n",
+           p.count, failed, bytes, seconds, started ? started : 1,
+           seconds > 0 ? p.count / seconds : 0.0,
+           seconds > 0 ? bytes / seconds / 1e6 : 0.0);
+
+    pthread_mutex_destroy(&p.lock);
+    xmss_verify_cache_free(&cache);
+    free(threads);
+    free(p.jobs);
+
+    return failed ? -1 : 0;
+}
@@ -11,34 +11,34 @@
  * Helper method for pseudorandom key generation.
  * Expands an n-byte array into a len*n byte array using the `prf_keygen` function.
  */
-static void expand_seed(const xmss_params *params,
-                        unsigned char *outseeds, const unsigned char *inseed, 
-                        const unsigned char *pub_seed, uint32_t addr[8])
+static void expand_seed(const xmss_params *params, xmss_thash_ctx *ctx,
+                        unsigned char *outseeds, const unsigned char *inseed,
+                        uint32_t addr[8])
 {
     uint32_t i;
-    unsigned char buf[params->n + 32];
+    /* The input pub_seed || addr is built in place, after the pub_seed
+       that ctx holds. */
+    unsigned char *buf = ctx->prf_in + params->padding_len;
 
     set_hash_addr(addr, 0);
     set_key_and_mask(addr, 0);
-    memcpy(buf, pub_seed, params->n);
     for (i = 0; i < params->wots_len; i++) {
         set_chain_addr(addr, i);
         addr_to_bytes(buf + params->n, addr);
-        prf_keygen(params, outseeds + i*params->n, buf, inseed);
+        prf_keygen_ctx(params, ctx, outseeds + i*params->n, buf, inseed);
     }
 }
 
 /**
- * Computes the chaining function.
- * out and in have to be n-byte arrays.
- *
- * Interprets in as start-th value of the chain.
- * addr has to contain the address of the chain.
+ * The chaining function, on the hash state that a WOTS operation keeps for
+ * all of its chains. With w = 256, a chain is up to 255 steps long, and with
+ * w = 4 there are up to 133 chains; either way, the state is set up once
+ * per operation rather than for every step.
  */
-static void gen_chain(const xmss_params *params,
-                      unsigned char *out, const unsigned char *in,
-                      unsigned int start, unsigned int steps,
-                      const unsigned char *pub_seed, uint32_t addr[8])
+static void walk_chain(const xmss_params *params, xmss_thash_ctx *ctx,
+                       unsigned char *out, const unsigned char *in,
+                       unsigned int start, unsigned int steps,
+                       uint32_t addr[8])
 {
     uint32_t i;
 
@@ -48,10 +48,29 @@ static void gen_chain(const xmss_params *params,
     /* Iterate 'steps' calls to the hash function. */
     for (i = start; i < (start+steps) && i < params->wots_w; i++) {
         set_hash_addr(addr, i);
-        thash_f(params, out, out, pub_seed, addr);
+        thash_f_ctx(params, ctx, out, out, addr);
     }
 }
 
+/**
+ * Computes the chaining function.
+ * out and in have to be n-byte arrays.
+ *
+ * Interprets in as start-th value of the chain.
+ * addr has to contain the address of the chain.
+ */
+void gen_chain(const xmss_params *params,
+               unsigned char *out, const unsigned char *in,
+               unsigned int start, unsigned int steps,
+               const unsigned char *pub_seed, uint32_t addr[8])
+{
+    xmss_thash_ctx ctx;
+
+    thash_ctx_init(params, &ctx, pub_seed);
+    walk_chain(params, &ctx, out, in, start, steps, addr);
+    thash_ctx_release(&ctx);
+}
+
 /**
  * base_w algorithm as described in draft.
  * Interprets an array of bytes as integers in base w.
@@ -66,6 +85,25 @@ static void base_w(const xmss_params *params,
     int bits = 0;
     int consumed;
 
+    /* The digits of the supported w are read straight from their byte. */
+    switch (params->wots_log_w) {
+        case 8:
+            for (out = 0; out < out_len; out++) {
+                output[out] = input[out];
+            }
+            return;
+        case 4:
+            for (out = 0; out < out_len; out++) {
+                output[out] = (input[out >> 1] >> (4 - 4*(out & 1))) & 15;
+            }
+            return;
+        case 2:
+            for (out = 0; out < out_len; out++) {
+                output[out] = (input[out >> 2] >> (6 - 2*(out & 3))) & 3;
+            }
+            return;
+    }
+
     for (consumed = 0; consumed < out_len; consumed++) {
         if (bits == 0) {
             total = input[in];
@@ -117,16 +155,27 @@ static void chain_lengths(const xmss_params *params,
 void wots_pkgen(const xmss_params *params,
                 unsigned char *pk, const unsigned char *seed,
                 const unsigned char *pub_seed, uint32_t addr[8])
+{
+    xmss_thash_ctx ctx;
+
+    thash_ctx_init(params, &ctx, pub_seed);
+    wots_pkgen_ctx(params, &ctx, pk, seed, addr);
+    thash_ctx_release(&ctx);
+}
+
+void wots_pkgen_ctx(const xmss_params *params, xmss_thash_ctx *ctx,
+                    unsigned char *pk, const unsigned char *seed,
+                    uint32_t addr[8])
 {
     uint32_t i;
 
     /* The WOTS+ private key is derived from the seed. */
-    expand_seed(params, pk, seed, pub_seed, addr);
+    expand_seed(params, ctx, pk, seed, addr);
 
     for (i = 0; i < params->wots_len; i++) {
         set_chain_addr(addr, i);
-        gen_chain(params, pk + i*params->n, pk + i*params->n,
-                  0, params->wots_w - 1, pub_seed, addr);
+        walk_chain(params, ctx, pk + i*params->n, pk + i*params->n,
+                   0, params->wots_w - 1, addr);
     }
 }
 
@@ -138,6 +187,17 @@ void wots_sign(const xmss_params *params,
                unsigned char *sig, const unsigned char *msg,
                const unsigned char *seed, const unsigned char *pub_seed,
                uint32_t addr[8])
+{
+    xmss_thash_ctx ctx;
+
+    thash_ctx_init(params, &ctx, pub_seed);
+    wots_sign_ctx(params, &ctx, sig, msg, seed, addr);
+    thash_ctx_release(&ctx);
+}
+
+void wots_sign_ctx(const xmss_params *params, xmss_thash_ctx *ctx,
+                   unsigned char *sig, const unsigned char *msg,
+                   const unsigned char *seed, uint32_t addr[8])
 {
     int lengths[params->wots_len];
     uint32_t i;
@@ -145,12 +205,106 @@ void wots_sign(const xmss_params *params,
     chain_lengths(params, lengths, msg);
 
     /* The WOTS+ private key is derived from the seed. */
-    expand_seed(params, sig, seed, pub_seed, addr);
+    expand_seed(params, ctx, sig, seed, addr);
+
+    for (i = 0; i < params->wots_len; i++) {
+        set_chain_addr(addr, i);
+        walk_chain(params, ctx, sig + i*params->n, sig + i*params->n,
+                   0, lengths[i], addr);
+    }
+}
+
+/**
+ * Returns the number of checkpoints that wots_checkpoints stores per chain
+ * for a given interval, i.e. the positions 0, interval, 2*interval, .. < w.
+ */
+unsigned int wots_checkpoint_count(const xmss_params *params,
+                                   unsigned int interval)
+{
+    return (params->wots_w - 1) / interval + 1;
+}
+
+/**
+ * Prepares a WOTS private key ahead of signing. For every chain, stores the
+ * values at the checkpoint positions 0, interval, 2*interval, .. < w, so
+ * that signing only has to walk a chain from the nearest checkpoint below
+ * its target. An interval of w stores the expanded private key only.
+ * Writes wots_len * wots_checkpoint_count(params, interval) * n bytes to 'cp'.
+ */
+void wots_checkpoints(const xmss_params *params,
+                      unsigned char *cp, const unsigned char *seed,
+                      const unsigned char *pub_seed, uint32_t addr[8],
+                      unsigned int interval)
+{
+    unsigned int count = wots_checkpoint_count(params, interval);
+    unsigned char sk[params->wots_sig_bytes];
+    unsigned char *out;
+    xmss_thash_ctx ctx;
+    uint32_t i, k;
+
+    thash_ctx_init(params, &ctx, pub_seed);
+
+    /* The WOTS+ private key is derived from the seed. */
+    expand_seed(params, &ctx, sk, seed, addr);
+
+    for (i = 0; i < params->wots_len; i++) {
+        set_chain_addr(addr, i);
+        out = cp + i*count*params->n;
+        memcpy(out, sk + i*params->n, params->n);
+        for (k = 1; k < count; k++) {
+            walk_chain(params, &ctx, out + k*params->n,
+                       out + (k - 1)*params->n, (k - 1)*interval, interval,
+                       addr);
+        }
+    }
+    thash_ctx_release(&ctx);
+}
 
+/**
+ * Takes a n-byte message and a private key as prepared by wots_checkpoints
+ * with the same interval to compute a signature that is placed at 'sig'.
+ * The result is identical to that of wots_sign.
+ */
+void wots_sign_checkpoints(const xmss_params *params,
+                           unsigned char *sig, const unsigned char *msg,
+                           const unsigned char *cp, unsigned int interval,
+                           const unsigned char *pub_seed, uint32_t addr[8])
+{
+    unsigned int count = wots_checkpoint_count(params, interval);
+    int lengths[params->wots_len];
+    xmss_thash_ctx ctx;
+    uint32_t i, k;
+
+    chain_lengths(params, lengths, msg);
+
+    thash_ctx_init(params, &ctx, pub_seed);
     for (i = 0; i < params->wots_len; i++) {
         set_chain_addr(addr, i);
-        gen_chain(params, sig + i*params->n, sig + i*params->n,
-                  0, lengths[i], pub_seed, addr);
+        /* Start at the nearest checkpoint below the target. */
+        k = lengths[i] / interval;
+        walk_chain(params, &ctx, sig + i*params->n,
+                   cp + (i*count + k)*params->n,
+                   k*interval, lengths[i] - k*interval, addr);
+    }
+    thash_ctx_release(&ctx);
+}
+
+void wots_pk_from_sig_chains_ctx(const xmss_params *params,
+                                 xmss_thash_ctx *ctx, unsigned char *pk,
+                                 const unsigned char *sig,
+                                 const unsigned char *msg,
+                                 unsigned int first, unsigned int last,
+                                 uint32_t addr[8])
+{
+    int lengths[params->wots_len];
+    uint32_t i;
+
+    chain_lengths(params, lengths, msg);
+
+    for (i = first; i < last; i++) {
+        set_chain_addr(addr, i);
+        walk_chain(params, ctx, pk + i*params->n, sig + i*params->n,
+                   lengths[i], params->wots_w - 1 - lengths[i], addr);
     }
 }
 
@@ -163,14 +317,30 @@ void wots_pk_from_sig(const xmss_params *params, unsigned char *pk,
                       const unsigned char *sig, const unsigned char *msg,
                       const unsigned char *pub_seed, uint32_t addr[8])
 {
-    int lengths[params->wots_len];
-    uint32_t i;
+    wots_pk_from_sig_chains(params, pk, sig, msg, 0, params->wots_len,
+                            pub_seed, addr);
+}
 
-    chain_lengths(params, lengths, msg);
+void wots_pk_from_sig_ctx(const xmss_params *params, xmss_thash_ctx *ctx,
+                          unsigned char *pk, const unsigned char *sig,
+                          const unsigned char *msg, uint32_t addr[8])
+{
+    wots_pk_from_sig_chains_ctx(params, ctx, pk, sig, msg,
+                                0, params->wots_len, addr);
+}
 
-    for (i = 0; i < params->wots_len; i++) {
-        set_chain_addr(addr, i);
-        gen_chain(params, pk + i*params->n, sig + i*params->n,
-                  lengths[i], params->wots_w - 1 - lengths[i], pub_seed, addr);
-    }
+/**
+ * As wots_pk_from_sig, but only computes the chains from 'first' up to
+ * (excluding) 'last'. Chain i is read from sig + i*n and written to pk + i*n.
+ */
+void wots_pk_from_sig_chains(const xmss_params *params, unsigned char *pk,
+                             const unsigned char *sig, const unsigned char *msg,
+                             unsigned int first, unsigned int last,
+                             const unsigned char *pub_seed, uint32_t addr[8])
+{
+    xmss_thash_ctx ctx;
+
+    thash_ctx_init(params, &ctx, pub_seed);
+    wots_pk_from_sig_chains_ctx(params, &ctx, pk, sig, msg, first, last, addr);
+    thash_ctx_release(&ctx);
 }
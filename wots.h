@@ -2,8 +2,19 @@
 #define XMSS_WOTS_H
 
 #include <stdint.h>
+#include "hash.h"
 #include "params.h"
 
+/**
+ * Computes the chaining function: walks 'steps' steps along the chain at
+ * addr from the value 'in' at position 'start', and writes the result to
+ * 'out'. out and in have to be n-byte arrays, and may overlap.
+ */
+void gen_chain(const xmss_params *params,
+               unsigned char *out, const unsigned char *in,
+               unsigned int start, unsigned int steps,
+               const unsigned char *pub_seed, uint32_t addr[8]);
+
 /**
  * WOTS key generation. Takes a 32 byte seed for the private key, expands it to
  * a full WOTS private key and computes the corresponding public key.
@@ -25,6 +36,51 @@ void wots_sign(const xmss_params *params,
                const unsigned char *seed, const unsigned char *pub_seed,
                uint32_t addr[8]);
 
+/**
+ * As wots_pkgen, wots_sign and wots_pk_from_sig, on the hash state of ctx,
+ * which holds the pub_seed. These neither allocate nor set up a digest.
+ */
+void wots_pkgen_ctx(const xmss_params *params, xmss_thash_ctx *ctx,
+                    unsigned char *pk, const unsigned char *seed,
+                    uint32_t addr[8]);
+
+void wots_sign_ctx(const xmss_params *params, xmss_thash_ctx *ctx,
+                   unsigned char *sig, const unsigned char *msg,
+                   const unsigned char *seed, uint32_t addr[8]);
+
+void wots_pk_from_sig_ctx(const xmss_params *params, xmss_thash_ctx *ctx,
+                          unsigned char *pk, const unsigned char *sig,
+                          const unsigned char *msg, uint32_t addr[8]);
+
+/**
+ * Returns the number of checkpoints that wots_checkpoints stores per chain
+ * for a given interval, i.e. the positions 0, interval, 2*interval, .. < w.
+ */
+unsigned int wots_checkpoint_count(const xmss_params *params,
+                                   unsigned int interval);
+
+/**
+ * Prepares a WOTS private key ahead of signing. For every chain, stores the
+ * values at the checkpoint positions 0, interval, 2*interval, .. < w, so
+ * that signing only has to walk a chain from the nearest checkpoint below
+ * its target. An interval of w stores the expanded private key only.
+ * Writes wots_len * wots_checkpoint_count(params, interval) * n bytes to 'cp'.
+ */
+void wots_checkpoints(const xmss_params *params,
+                      unsigned char *cp, const unsigned char *seed,
+                      const unsigned char *pub_seed, uint32_t addr[8],
+                      unsigned int interval);
+
+/**
+ * Takes a n-byte message and a private key as prepared by wots_checkpoints
+ * with the same interval to compute a signature that is placed at 'sig'.
+ * The result is identical to that of wots_sign.
+ */
+void wots_sign_checkpoints(const xmss_params *params,
+                           unsigned char *sig, const unsigned char *msg,
+                           const unsigned char *cp, unsigned int interval,
+                           const unsigned char *pub_seed, uint32_t addr[8]);
+
 /**
  * Takes a WOTS signature and an n-byte message, computes a WOTS public key.
  *
@@ -34,4 +90,22 @@ void wots_pk_from_sig(const xmss_params *params, unsigned char *pk,
                       const unsigned char *sig, const unsigned char *msg,
                       const unsigned char *pub_seed, uint32_t addr[8]);
 
+/**
+ * As wots_pk_from_sig, but only computes the chains from 'first' up to
+ * (excluding) 'last'. Chain i is read from sig + i*n and written to pk + i*n.
+ * This allows a signature to be processed as its chains become available.
+ */
+void wots_pk_from_sig_chains(const xmss_params *params, unsigned char *pk,
+                             const unsigned char *sig, const unsigned char *msg,
+                             unsigned int first, unsigned int last,
+                             const unsigned char *pub_seed, uint32_t addr[8]);
+
+/* As wots_pk_from_sig_chains, on the hash state of ctx. */
+void wots_pk_from_sig_chains_ctx(const xmss_params *params,
+                                 xmss_thash_ctx *ctx, unsigned char *pk,
+                                 const unsigned char *sig,
+                                 const unsigned char *msg,
+                                 unsigned int first, unsigned int last,
+                                 uint32_t addr[8]);
+
 #endif
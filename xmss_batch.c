@@ -0,0 +1,233 @@
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "hash.h"
+#include "hash_address.h"
+#include "params.h"
+#include "utils.h"
+#include "xmss_core.h"
+#include "xmss_batch.h"
+
+unsigned int xmss_batch_height(unsigned int count)
+{
+    unsigned int height = 0;
+
+    while ((1ULL << height) < count) {
+        height++;
+    }
+    return height;
+}
+
+unsigned long long xmss_batch_sig_bytes(const xmss_params *params,
+                                        unsigned int height)
+{
+    return params->sig_bytes + 1 + 4 + height * params->n;
+}
+
+/**
+ * Computes the leaf for message m at position i of the batch. This is the
+ * regular randomized message hash, using the R and root of the signature
+ * over the batch, with the position in the batch as index.
+ */
+static int batch_leaf(const xmss_params *params, unsigned char *leaf,
+                      const unsigned char *R, const unsigned char *root,
+                      uint32_t i, const unsigned char *m,
+                      unsigned long long mlen)
+{
+    xmss_hash_msg_ctx hash;
+
+    if (hash_message_init(params, &hash, R, root, i)) {
+        return -1;
+    }
+    if (hash_message_update(params, &hash, m, mlen)) {
+        hash_message_final(params, &hash, leaf);
+        return -1;
+    }
+    return hash_message_final(params, &hash, leaf);
+}
+
+int xmssmt_core_batch_sign(const xmss_params *params, unsigned char *sk,
+                           unsigned char *sigs,
+                           const unsigned char **ms,
+                           const unsigned long long *mlens,
+                           unsigned int count)
+{
+    const unsigned char *sk_prf = sk + params->index_bytes + params->n;
+    const unsigned char *pub_root = sk + params->index_bytes + 2*params->n;
+    const unsigned char *pub_seed = sk + params->index_bytes + 3*params->n;
+
+    unsigned int height = xmss_batch_height(count);
+    unsigned long long sig_len = xmss_batch_sig_bytes(params, height);
+    unsigned long long smlen;
+    unsigned long long idx;
+    unsigned char idx_bytes_32[32];
+    unsigned char R[params->n];
+    unsigned char msg[XMSS_BATCH_TAG_BYTES + params->n];
+    unsigned char *tree;
+    unsigned char *sm;
+    unsigned char *out;
+    uint32_t addr[8] = {0};
+    uint32_t i, j, k;
+    unsigned int level;
+
+    if (count == 0 || height > XMSS_BATCH_MAX_HEIGHT) {
+        return -1;
+    }
+    /* The tree is stored as a binary heap; node k has children 2k, 2k+1.
+       Leaves beyond 'count' remain zero. */
+    tree = calloc(2ULL << height, params->n);
+    sm = malloc(params->sig_bytes + sizeof(msg));
+    if (tree == NULL || sm == NULL) {
+        free(tree);
+        free(sm);
+        return -1;
+    }
+
+    /* The leaves use the R that xmssmt_core_sign derives for this index. */
+    idx = bytes_to_ull(sk, params->index_bytes);
+    ull_to_bytes(idx_bytes_32, 32, idx);
+    prf(params, R, idx_bytes_32, sk_prf);
+
+    for (i = 0; i < count; i++) {
+        if (batch_leaf(params, tree + ((1ULL << height) + i)*params->n,
+                       R, pub_root, i, ms[i], mlens[i])) {
+            free(tree);
+            free(sm);
+            return -1;
+        }
+    }
+
+    /* The tree is tied to this index, so that every batch uses other masks. */
+    set_tree_addr(addr, idx);
+    set_type(addr, XMSS_ADDR_TYPE_BATCH);
+
+    for (level = 0; level < height; level++) {
+        set_tree_height(addr, level);
+        for (j = 0; j < (1U << (height - level - 1)); j++) {
+            k = (1U << (height - level - 1)) + j;
+            set_tree_index(addr, j);
+            thash_h(params, tree + k*params->n, tree + 2*k*params->n,
+                    pub_seed, addr);
+        }
+    }
+
+    /* Sign the tagged root of the batch tree, which is at position 1. No
+       signature is written when this fails, e.g. because the key is used up. */
+    memcpy(msg, XMSS_BATCH_TAG, XMSS_BATCH_TAG_BYTES);
+    memcpy(msg + XMSS_BATCH_TAG_BYTES, tree + params->n, params->n);
+    if (xmssmt_core_sign(params, sk, sm, &smlen, msg, sizeof(msg))) {
+        free(tree);
+        free(sm);
+        return -1;
+    }
+
+    for (i = 0; i < count; i++) {
+        out = sigs + i*sig_len;
+        memcpy(out, sm, params->sig_bytes);
+        out[params->sig_bytes] = height;
+        ull_to_bytes(out + params->sig_bytes + 1, 4, i);
+        out += params->sig_bytes + 1 + 4;
+
+        k = (1U << height) + i;
+        for (level = 0; level < height; level++) {
+            memcpy(out + level*params->n, tree + (k ^ 1)*params->n, params->n);
+            k >>= 1;
+        }
+    }
+
+    free(tree);
+    free(sm);
+
+    return 0;
+}
+
+int xmssmt_core_batch_verify(const xmss_params *params,
+                             const unsigned char *sig, unsigned long long siglen,
+                             const unsigned char *m, unsigned long long mlen,
+                             const unsigned char *pk)
+{
+    const unsigned char *pub_root = pk;
+    const unsigned char *pub_seed = pk + params->n;
+    const unsigned char *auth_path;
+
+    unsigned char buffer[2*params->n];
+    unsigned char *node;
+    unsigned char *sm;
+    unsigned long long idx;
+    unsigned long long smlen;
+    unsigned long long mlen_root;
+    unsigned int height;
+    unsigned int level;
+    uint32_t addr[8] = {0};
+    uint32_t i;
+    int ret;
+
+    if (siglen < params->sig_bytes + 1 + 4) {
+        return -1;
+    }
+    height = sig[params->sig_bytes];
+    if (height > XMSS_BATCH_MAX_HEIGHT ||
+        siglen != xmss_batch_sig_bytes(params, height)) {
+        return -1;
+    }
+    i = bytes_to_ull(sig + params->sig_bytes + 1, 4);
+    if (i >> height) {
+        return -1;
+    }
+    auth_path = sig + params->sig_bytes + 1 + 4;
+
+    sm = malloc(2 * (params->sig_bytes + XMSS_BATCH_TAG_BYTES + params->n));
+    if (sm == NULL) {
+        return -1;
+    }
+
+    idx = bytes_to_ull(sig, params->index_bytes);
+    set_tree_addr(addr, idx);
+    set_type(addr, XMSS_ADDR_TYPE_BATCH);
+
+    /* Climb from the leaf of m to the root of the batch tree. */
+    node = (i & 1) ? buffer + params->n : buffer;
+    if (batch_leaf(params, node, sig + params->index_bytes, pub_root, i,
+                   m, mlen)) {
+        free(sm);
+        return -1;
+    }
+    for (level = 0; level < height; level++) {
+        memcpy((i & 1) ? buffer : buffer + params->n,
+               auth_path + level*params->n, params->n);
+        i >>= 1;
+        set_tree_height(addr, level);
+        set_tree_index(addr, i);
+        node = (i & 1) ? buffer + params->n : buffer;
+        thash_h(params, node, buffer, pub_seed, addr);
+    }
+
+    /* The tagged batch root is the message of the shared signature. */
+    memcpy(sm, sig, params->sig_bytes);
+    memcpy(sm + params->sig_bytes, XMSS_BATCH_TAG, XMSS_BATCH_TAG_BYTES);
+    memcpy(sm + params->sig_bytes + XMSS_BATCH_TAG_BYTES, node, params->n);
+    smlen = params->sig_bytes + XMSS_BATCH_TAG_BYTES + params->n;
+    ret = xmssmt_core_sign_open(params, sm + smlen, &mlen_root, sm, smlen, pk);
+
+    free(sm);
+
+    return ret;
+}
+
+int xmss_core_batch_sign(const xmss_params *params, unsigned char *sk,
+                         unsigned char *sigs,
+                         const unsigned char **ms,
+                         const unsigned long long *mlens,
+                         unsigned int count)
+{
+    return xmssmt_core_batch_sign(params, sk, sigs, ms, mlens, count);
+}
+
+int xmss_core_batch_verify(const xmss_params *params,
+                           const unsigned char *sig, unsigned long long siglen,
+                           const unsigned char *m, unsigned long long mlen,
+                           const unsigned char *pk)
+{
+    return xmssmt_core_batch_verify(params, sig, siglen, m, mlen, pk);
+}
@@ -0,0 +1,77 @@
+#ifndef XMSS_BATCH_H
+#define XMSS_BATCH_H
+
+#include "params.h"
+
+/* Upper bound on the height of the tree over the messages of a batch. */
+#define XMSS_BATCH_MAX_HEIGHT 20
+
+/* Precedes the batch root in the message of the shared signature. */
+#define XMSS_BATCH_TAG "XMSS-BATCH-ROOT"
+#define XMSS_BATCH_TAG_BYTES (sizeof(XMSS_BATCH_TAG) - 1)
+
+/*
+ * Merkle-batched signing. A single XMSS(MT) signature is computed over the
+ * root of a hash tree over the messages of a batch, so that the batch only
+ * consumes one index. Each message receives the shared XMSS(MT) signature,
+ * followed by its position in the batch and its path in the batch tree:
+ *
+ *   sig (params->sig_bytes) || height (1 byte) || leaf index (4 bytes)
+ *       || authentication path (height * n bytes)
+ *
+ * This is not an RFC 8391 signature; it can only be verified with
+ * xmssmt_core_batch_verify. The shared signature is on XMSS_BATCH_TAG
+ * followed by the root, so that it is no signature on the root bytes as a
+ * message of their own. Keys that sign batches should not sign messages
+ * that start with XMSS_BATCH_TAG otherwise.
+ */
+
+/**
+ * Returns the height of the batch tree for 'count' messages.
+ */
+unsigned int xmss_batch_height(unsigned int count);
+
+/**
+ * Returns the size of each per-message signature for a batch tree of the
+ * given height.
+ */
+unsigned long long xmss_batch_sig_bytes(const xmss_params *params,
+                                        unsigned int height);
+
+/**
+ * Signs the 'count' messages ms[i] of length mlens[i], consuming a single
+ * index of sk. Writes count signatures of xmss_batch_sig_bytes(params,
+ * xmss_batch_height(count)) bytes each to sigs, in the order of ms.
+ * Returns -1 if count is 0 or exceeds 2^XMSS_BATCH_MAX_HEIGHT, or if the
+ * batch root cannot be signed, e.g. because the key is used up; nothing is
+ * written to sigs then.
+ */
+int xmssmt_core_batch_sign(const xmss_params *params, unsigned char *sk,
+                           unsigned char *sigs,
+                           const unsigned char **ms,
+                           const unsigned long long *mlens,
+                           unsigned int count);
+
+/**
+ * Verifies a per-message signature of length siglen on the message m of
+ * length mlen under the public key pk (without OID).
+ * Returns 0 on success, -1 otherwise.
+ */
+int xmssmt_core_batch_verify(const xmss_params *params,
+                             const unsigned char *sig, unsigned long long siglen,
+                             const unsigned char *m, unsigned long long mlen,
+                             const unsigned char *pk);
+
+/* The XMSS variants; XMSS is XMSS^MT with d = 1. */
+int xmss_core_batch_sign(const xmss_params *params, unsigned char *sk,
+                         unsigned char *sigs,
+                         const unsigned char **ms,
+                         const unsigned long long *mlens,
+                         unsigned int count);
+
+int xmss_core_batch_verify(const xmss_params *params,
+                           const unsigned char *sig, unsigned long long siglen,
+                           const unsigned char *m, unsigned long long mlen,
+                           const unsigned char *pk);
+
+#endif
@@ -0,0 +1,242 @@
+#include <stdint.h>
+#include <string.h>
+
+#include "hash.h"
+#include "hash_address.h"
+#include "params.h"
+#include "wots.h"
+#include "utils.h"
+#include "xmss_core_steps.h"
+#include "xmss_tree.h"
+
+/* Upper bound on the number of tweakable hash calls of a WOTS key pair. */
+static unsigned long long wots_cost(const xmss_params *params)
+{
+    return (unsigned long long)params->wots_len * params->wots_w;
+}
+
+/* Prepares the state for the subtree on the current layer. */
+static void start_layer(xmss_sign_state *state)
+{
+    const xmss_params *params = state->params;
+
+    state->idx_leaf = (state->idx & (((uint32_t)1 << params->tree_height) - 1));
+    state->idx = state->idx >> params->tree_height;
+
+    set_layer_addr(state->ots_addr, state->layer);
+    set_tree_addr(state->ots_addr, state->idx);
+    set_ots_addr(state->ots_addr, state->idx_leaf);
+
+    state->wots_done = 0;
+    state->next_leaf = 0;
+    state->offset = 0;
+}
+
+/**
+ * Performs one iteration of the treehash algorithm used by xmss_core_sign,
+ * storing the nodes needed for the authentication path.
+ * Returns the number of tweakable hash calls that were spent.
+ */
+static unsigned long long treehash_leaf(xmss_sign_state *state)
+{
+    const xmss_params *params = state->params;
+    unsigned char wots_pk[params->wots_sig_bytes];
+    unsigned int merged;
+
+    merged = xmss_treehash_leaf(params, &state->thash, state->stack,
+                                state->heights, &state->offset, wots_pk,
+                                state->sig, state->sk_seed, state->idx_leaf,
+                                state->next_leaf, state->ots_addr);
+    state->next_leaf++;
+    return wots_cost(params) + params->wots_len - 1 + merged;
+}
+
+int xmssmt_core_sign_msg_init(const xmss_params *params,
+                              xmss_sign_state *state,
+                              unsigned char *sk, unsigned char *sig)
+{
+    const unsigned char *sk_prf = sk + params->index_bytes + params->n;
+    const unsigned char *pub_root = sk + params->index_bytes + 2*params->n;
+    unsigned char idx_bytes_32[32];
+    int ret;
+
+    if (params->n > XMSS_STEPS_MAX_N ||
+        params->tree_height > XMSS_STEPS_MAX_TREE_HEIGHT) {
+        return -1;
+    }
+    /* Only the index is advanced, which would leave the BDS state of a key
+       stale: such keys are refused. */
+    if (params->sk_bytes != params->index_bytes + 4*params->n) {
+        return -1;
+    }
+    /* The last index is left unused, as in xmss_ctx_sign: a used-up key
+       has no index value left to mark it. */
+    if (bytes_to_ull(sk, params->index_bytes) >=
+        (1ULL << params->full_height) - 1) {
+        return -1;
+    }
+
+    memset(state, 0, sizeof(xmss_sign_state));
+    XMSS_TRACE_START(&state->trace);
+    state->params = params;
+    state->sk_seed = sk + params->index_bytes;
+    state->pub_seed = sk + params->index_bytes + 3*params->n;
+    set_type(state->ots_addr, XMSS_ADDR_TYPE_OTS);
+
+    /* Read and use the current index from the secret key. */
+    state->idx = bytes_to_ull(sk, params->index_bytes);
+    memcpy(sig, sk, params->index_bytes);
+
+    /* Increment the index in the secret key. */
+    ull_to_bytes(sk, params->index_bytes, state->idx + 1);
+    XMSS_TRACE_STOP(&state->trace, XMSS_PHASE_SIGN_STATE);
+
+    /* Compute the digest randomization value. */
+    XMSS_TRACE_START(&state->trace);
+    ull_to_bytes(idx_bytes_32, 32, state->idx);
+    prf(params, sig + params->index_bytes, idx_bytes_32, sk_prf);
+
+    state->sig = sig + params->index_bytes + params->n;
+
+    ret = hash_message_init(params, &state->hash, sig + params->index_bytes,
+                            pub_root, state->idx);
+    XMSS_TRACE_STOP(&state->trace, XMSS_PHASE_SIGN_MSG_HASH);
+    return ret;
+}
+
+int xmssmt_core_sign_msg_update(xmss_sign_state *state,
+                                const unsigned char *m, unsigned long long mlen)
+{
+    if (state->failed) {
+        return -1;
+    }
+    XMSS_TRACE_START(&state->trace);
+    state->failed = hash_message_update(state->params, &state->hash, m, mlen);
+    XMSS_TRACE_STOP(&state->trace, XMSS_PHASE_SIGN_MSG_HASH);
+    return state->failed;
+}
+
+int xmssmt_core_sign_msg_final(xmss_sign_state *state)
+{
+    int ret;
+
+    /* The first layer signs the message hash as its 'root'. */
+    XMSS_TRACE_START(&state->trace);
+    ret = hash_message_final(state->params, &state->hash, state->root);
+    XMSS_TRACE_STOP(&state->trace, XMSS_PHASE_SIGN_MSG_HASH);
+    if (ret || state->failed) {
+        return -1;
+    }
+    thash_ctx_init(state->params, &state->thash, state->pub_seed);
+    start_layer(state);
+    return 0;
+}
+
+int xmssmt_core_sign_begin(const xmss_params *params, xmss_sign_state *state,
+                           unsigned char *sk,
+                           unsigned char *sm, unsigned long long *smlen,
+                           const unsigned char *m, unsigned long long mlen)
+{
+    if (xmssmt_core_sign_msg_init(params, state, sk, sm)) {
+        return -1;
+    }
+    if (xmssmt_core_sign_msg_update(state, m, mlen)) {
+        xmssmt_core_sign_msg_final(state);
+        return -1;
+    }
+    if (xmssmt_core_sign_msg_final(state)) {
+        return -1;
+    }
+
+    memcpy(sm + params->sig_bytes, m, mlen);
+    *smlen = params->sig_bytes + mlen;
+
+    return 0;
+}
+
+int xmssmt_core_sign_step(xmss_sign_state *state, unsigned long long budget)
+{
+    const xmss_params *params = state->params;
+    unsigned long long spent = 0;
+
+    do {
+        if (state->layer == params->d) {
+            return 0;
+        }
+        if (!state->wots_done) {
+            /* Sign the message hash or the root of the subtree below. */
+            XMSS_TRACE_START(&state->trace);
+            wots_sign_ctx(params, &state->thash, state->sig, state->root,
+                          state->sk_seed, state->ots_addr);
+            XMSS_TRACE_STOP(&state->trace, state->layer
+                            ? XMSS_PHASE_SIGN_UPPER_LAYERS
+                            : XMSS_PHASE_SIGN_WOTS);
+            state->sig += params->wots_sig_bytes;
+            state->wots_done = 1;
+            spent += wots_cost(params);
+        }
+        else if (state->next_leaf < (uint32_t)1 << params->tree_height) {
+            XMSS_TRACE_START(&state->trace);
+            spent += treehash_leaf(state);
+            XMSS_TRACE_STOP(&state->trace, state->layer
+                            ? XMSS_PHASE_SIGN_UPPER_LAYERS
+                            : XMSS_PHASE_SIGN_AUTH_PATH);
+        }
+        else {
+            /* The authentication path is complete; move up one layer. */
+            memcpy(state->root, state->stack, params->n);
+            state->sig += params->tree_height*params->n;
+            state->layer++;
+            if (state->layer < params->d) {
+                start_layer(state);
+            }
+        }
+    } while (spent < budget);
+
+    return state->layer < params->d;
+}
+
+int xmssmt_core_sign_finish(xmss_sign_state *state)
+{
+    while (xmssmt_core_sign_step(state, (unsigned long long)-1));
+    XMSS_TRACE_EMIT(&state->trace);
+    thash_ctx_release(&state->thash);
+    memset(state, 0, sizeof(xmss_sign_state));
+    return 0;
+}
+
+int xmss_core_sign_begin(const xmss_params *params, xmss_sign_state *state,
+                         unsigned char *sk,
+                         unsigned char *sm, unsigned long long *smlen,
+                         const unsigned char *m, unsigned long long mlen)
+{
+    return xmssmt_core_sign_begin(params, state, sk, sm, smlen, m, mlen);
+}
+
+int xmss_core_sign_msg_init(const xmss_params *params,
+                            xmss_sign_state *state,
+                            unsigned char *sk, unsigned char *sig)
+{
+    return xmssmt_core_sign_msg_init(params, state, sk, sig);
+}
+
+int xmss_core_sign_msg_update(xmss_sign_state *state,
+                              const unsigned char *m, unsigned long long mlen)
+{
+    return xmssmt_core_sign_msg_update(state, m, mlen);
+}
+
+int xmss_core_sign_msg_final(xmss_sign_state *state)
+{
+    return xmssmt_core_sign_msg_final(state);
+}
+
+int xmss_core_sign_step(xmss_sign_state *state, unsigned long long budget)
+{
+    return xmssmt_core_sign_step(state, budget);
+}
+
+int xmss_core_sign_finish(xmss_sign_state *state)
+{
+    return xmssmt_core_sign_finish(state);
+}
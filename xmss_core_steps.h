@@ -0,0 +1,119 @@
+#ifndef XMSS_CORE_STEPS_H
+#define XMSS_CORE_STEPS_H
+
+#include <stdint.h>
+#include "hash.h"
+#include "params.h"
+#include "xmss_trace.h"
+
+/* Upper bounds for the state kept in between steps. */
+#define XMSS_STEPS_MAX_N 64
+#define XMSS_STEPS_MAX_TREE_HEIGHT 20
+
+/**
+ * State of a signature that is computed in several steps. The fields are
+ * internal; the struct is only exposed so that callers can allocate it.
+ */
+typedef struct {
+    const xmss_params *params;
+    const unsigned char *sk_seed;
+    const unsigned char *pub_seed;
+    unsigned char *sig;
+    unsigned long long idx;
+    uint32_t idx_leaf;
+    unsigned int layer;
+    unsigned int wots_done;
+    uint32_t ots_addr[8];
+    unsigned char root[XMSS_STEPS_MAX_N];
+    xmss_hash_msg_ctx hash;
+    /* Set when a part of the message could not be hashed. */
+    int failed;
+    /* The hash state under pub_seed, from xmssmt_core_sign_msg_final on. */
+    xmss_thash_ctx thash;
+    /* Treehash progress for the subtree of the current layer. */
+    uint32_t next_leaf;
+    unsigned int offset;
+    unsigned int heights[XMSS_STEPS_MAX_TREE_HEIGHT + 1];
+    unsigned char stack[(XMSS_STEPS_MAX_TREE_HEIGHT + 1) * XMSS_STEPS_MAX_N];
+    /* Time per phase, when built with XMSS_TRACE (see xmss_trace.h). */
+    xmss_trace trace;
+} xmss_sign_state;
+
+/**
+ * Starts a signature on the message m of length mlen. This performs all work
+ * that does not depend on the tree: the index is read from and incremented
+ * in sk, and the randomized message hash is computed. Note that sk has to be
+ * stored before any of the resulting signature is released, exactly as with
+ * xmssmt_core_sign.
+ *
+ * The signed message is written to sm as the signature is completed; sk and
+ * sm must remain valid until xmssmt_core_sign_finish returns.
+ * Returns -1 when the parameters exceed the bounds of xmss_sign_state, when
+ * the key keeps BDS state (which the step-wise signer would not update), or
+ * when all signatures of the key have been used; sk is then unchanged.
+ */
+int xmssmt_core_sign_begin(const xmss_params *params, xmss_sign_state *state,
+                           unsigned char *sk,
+                           unsigned char *sm, unsigned long long *smlen,
+                           const unsigned char *m, unsigned long long mlen);
+
+/**
+ * Starts a signature on a message that is passed in parts, so that it never
+ * has to be in memory at once. As with xmssmt_core_sign_begin, the index is
+ * read from and incremented in sk. The signature of sig_bytes bytes is
+ * written to sig, without the message; sk and sig must remain valid until
+ * xmssmt_core_sign_finish returns.
+ *
+ * The message is passed to xmssmt_core_sign_msg_update in any number of
+ * parts, and xmssmt_core_sign_msg_final completes it, after which the
+ * signature is computed with xmssmt_core_sign_step and _finish.
+ * xmssmt_core_sign_msg_final has to be called also when an update fails;
+ * it then releases the state and fails as well.
+ * xmssmt_core_sign_msg_init refuses the same keys as xmssmt_core_sign_begin.
+ */
+int xmssmt_core_sign_msg_init(const xmss_params *params,
+                              xmss_sign_state *state,
+                              unsigned char *sk, unsigned char *sig);
+
+int xmssmt_core_sign_msg_update(xmss_sign_state *state,
+                                const unsigned char *m, unsigned long long mlen);
+
+int xmssmt_core_sign_msg_final(xmss_sign_state *state);
+
+/**
+ * Continues the signature for roughly 'budget' tweakable hash calls. Work is
+ * done in units of one WOTS signature or one tree leaf, so a single step
+ * may exceed the budget by at most one such unit, and always makes progress.
+ * Returns 1 while work remains, 0 once the signature is complete.
+ */
+int xmssmt_core_sign_step(xmss_sign_state *state, unsigned long long budget);
+
+/**
+ * Completes the signature by running all remaining steps, and clears the
+ * state. With a core that keeps no BDS state in the key, the output is
+ * identical to that of xmssmt_core_sign.
+ */
+int xmssmt_core_sign_finish(xmss_sign_state *state);
+
+/*
+ * The XMSS variants. As XMSS is XMSS^MT with d = 1, these only differ in name.
+ */
+int xmss_core_sign_begin(const xmss_params *params, xmss_sign_state *state,
+                         unsigned char *sk,
+                         unsigned char *sm, unsigned long long *smlen,
+                         const unsigned char *m, unsigned long long mlen);
+
+int xmss_core_sign_msg_init(const xmss_params *params,
+                            xmss_sign_state *state,
+                            unsigned char *sk, unsigned char *sig);
+
+int xmss_core_sign_msg_update(xmss_sign_state *state,
+                              const unsigned char *m, unsigned long long mlen);
+
+int xmss_core_sign_msg_final(xmss_sign_state *state);
+
+int xmss_core_sign_step(xmss_sign_state *state, unsigned long long budget);
+
+int xmss_core_sign_finish(xmss_sign_state *state);
+
+#endif
@@ -0,0 +1,347 @@
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "hash.h"
+#include "params.h"
+#include "wots.h"
+#include "xmss_cost.h"
+
+/* Primitives are timed in blocks, to make the clock overhead negligible;
+   F is timed along a complete chain of w = 256, as WOTS calls it. */
+#define CALIBRATE_BLOCK 16
+/* The message length at which the per-byte cost of hashing is measured. */
+#define CALIBRATE_MLEN 1024
+
+/* The primitives that are measured. */
+enum {
+    PRIM_PRF,
+    PRIM_PRF_KEYGEN,
+    PRIM_THASH_F,
+    PRIM_THASH_H,
+    PRIM_MSG_FIXED,
+    PRIM_MSG_LONG,
+    PRIMS
+};
+
+static const unsigned int cost_n[] = {24, 32, 64};
+
+static unsigned long long nanoseconds(void)
+{
+    struct timespec t;
+
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return (unsigned long long)t.tv_sec * 1000000000ULL + t.tv_nsec;
+}
+
+static int compare(const void *a, const void *b)
+{
+    unsigned long long x = *(const unsigned long long *)a;
+    unsigned long long y = *(const unsigned long long *)b;
+
+    return (x > y) - (x < y);
+}
+
+/* Returns the median time of one call of the primitive, in ns. */
+static double time_primitive(const xmss_params *params, unsigned int prim,
+                             unsigned int runs, unsigned long long *samples)
+{
+    unsigned char key[params->n];
+    unsigned char pub_seed[params->n];
+    unsigned char in[32 + 2*params->n];
+    unsigned char out[params->n];
+    unsigned char m[params->padding_len + 3*params->n + CALIBRATE_MLEN];
+    uint32_t addr[8] = {0};
+    unsigned int block = prim == PRIM_THASH_F ? 1 : CALIBRATE_BLOCK;
+    unsigned int calls = prim == PRIM_THASH_F ? params->wots_w - 1 : block;
+    unsigned long long t0;
+    unsigned int i;
+    unsigned int j;
+
+    memset(key, 1, sizeof(key));
+    memset(pub_seed, 2, sizeof(pub_seed));
+    memset(in, 3, sizeof(in));
+    memset(m, 4, sizeof(m));
+
+    for (i = 0; i < runs; i++) {
+        t0 = nanoseconds();
+        for (j = 0; j < block; j++) {
+            switch (prim) {
+                case PRIM_PRF:
+                    prf(params, out, in, key);
+                    break;
+                case PRIM_PRF_KEYGEN:
+                    prf_keygen(params, out, in, key);
+                    break;
+                case PRIM_THASH_F:
+                    gen_chain(params, out, in, 0, params->wots_w - 1,
+                              pub_seed, addr);
+                    break;
+                case PRIM_THASH_H:
+                    thash_h(params, out, in, pub_seed, addr);
+                    break;
+                case PRIM_MSG_FIXED:
+                    hash_message(params, out, key, pub_seed, j, m, 0);
+                    break;
+                default:
+                    hash_message(params, out, key, pub_seed, j, m,
+                                 CALIBRATE_MLEN);
+                    break;
+            }
+        }
+        samples[i] = nanoseconds() - t0;
+    }
+    qsort(samples, runs, sizeof(unsigned long long), compare);
+    return (double)samples[runs / 2] / calls;
+}
+
+int xmss_cost_calibrate(xmss_cost_model *model, unsigned int runs)
+{
+    xmss_params params;
+    xmss_cost_primitives *c;
+    double t[PRIMS];
+    unsigned long long *samples;
+    unsigned int func;
+    unsigned int n;
+    unsigned int prim;
+
+    if (runs == 0) {
+        return -1;
+    }
+    samples = malloc(runs * sizeof(unsigned long long));
+    if (samples == NULL) {
+        return -1;
+    }
+    memset(model, 0, sizeof(xmss_cost_model));
+
+    for (func = 0; func < 3; func++) {
+        for (n = 0; n < 3; n++) {
+            /* Sets that are not supported stay at zero cost. */
+            if (xmss_params_custom(&params, func, cost_n[n], 10, 1, 256,
+                                   0)) {
+                continue;
+            }
+            for (prim = 0; prim < PRIMS; prim++) {
+                t[prim] = time_primitive(&params, prim, runs, samples);
+            }
+            c = &model->hash[func][n];
+            c->prf = t[PRIM_PRF];
+            c->prf_keygen = t[PRIM_PRF_KEYGEN];
+            c->thash_f = t[PRIM_THASH_F];
+            c->thash_h = t[PRIM_THASH_H];
+            c->msg_fixed = t[PRIM_MSG_FIXED];
+            c->msg_byte = t[PRIM_MSG_LONG] > t[PRIM_MSG_FIXED]
+                ? (t[PRIM_MSG_LONG] - t[PRIM_MSG_FIXED]) / CALIBRATE_MLEN
+                : 0;
+
+            /* A key without BDS state holds just the index and 4 seeds. */
+            model->bds = params.sk_bytes > params.index_bytes + 4*params.n;
+        }
+    }
+    free(samples);
+    return 0;
+}
+
+/* Looks up the RFC 8391 OID of params, or makes a private-use one. */
+static int params_oid(uint32_t *oid, const xmss_params *params, int mt)
+{
+    const xmss_params *p;
+    uint32_t i;
+
+    for (i = 1; (p = xmss_params_lookup(i, mt)) != NULL; i++) {
+        if (p->func == params->func && p->n == params->n &&
+            p->full_height == params->full_height && p->d == params->d &&
+            p->wots_w == params->wots_w && p->bds_k == params->bds_k) {
+            *oid = i;
+            return 0;
+        }
+    }
+    return xmss_params_to_oid(oid, params);
+}
+
+int xmss_cost_estimate_params(xmss_cost_estimate *estimate,
+                              const xmss_cost_model *model,
+                              const xmss_params *params,
+                              unsigned long long mlen)
+{
+    const xmss_cost_primitives *c = NULL;
+    double wots_pkgen, wots_sign, wots_verify, ltree, leaf, tree, msg;
+    double len = params->wots_len;
+    double chain = params->wots_w - 1;
+    double th = params->tree_height;
+    double d = params->d;
+    double leaves = (double)(1ULL << params->tree_height);
+    unsigned int i;
+
+    for (i = 0; i < 3; i++) {
+        if (params->func < 3 && cost_n[i] == params->n) {
+            c = &model->hash[params->func][i];
+        }
+    }
+    if (c == NULL || c->thash_f == 0) {
+        return -1;
+    }
+
+    /* The costs of the building blocks, in calls of the primitives. On
+       average, a signature covers half of every chain. */
+    wots_pkgen = len * c->prf_keygen + len * chain * c->thash_f;
+    wots_sign = len * c->prf_keygen + len * chain / 2 * c->thash_f;
+    wots_verify = len * chain / 2 * c->thash_f;
+    ltree = (len - 1) * c->thash_h;
+    leaf = wots_pkgen + ltree;
+    tree = leaves * leaf + (leaves - 1) * c->thash_h;
+    msg = c->msg_fixed + mlen * c->msg_byte;
+
+    memset(estimate, 0, sizeof(xmss_cost_estimate));
+    estimate->params = *params;
+    estimate->mt = params->d > 1;
+    if (params_oid(&estimate->oid, params, estimate->mt)) {
+        return -1;
+    }
+
+    if (model->bds) {
+        /* Keygen builds the first tree of every layer, and signs all but
+           the bottom one. A signature then updates (h - k) / 2 treehash
+           instances of the bottom tree, computes a left node half of the
+           time, and with more layers prepares the next tree, a leaf per
+           signature. */
+        estimate->keygen_ns = d * tree + (d - 1) * wots_sign;
+        estimate->sign_ns = c->prf + msg + wots_sign +
+            ((th - params->bds_k) / 2 + 0.5 + (params->d > 1 ? 1 : 0)) *
+            (leaf + c->thash_h);
+    }
+    else {
+        /* Keygen builds the top tree. Every signature builds a tree per
+           layer, for its authentication path. */
+        estimate->keygen_ns = tree;
+        estimate->sign_ns = c->prf + msg + d * (tree + wots_sign);
+    }
+    estimate->verify_ns = msg + d * (wots_verify + ltree + th * c->thash_h);
+    return 0;
+}
+
+typedef struct {
+    double key;
+    xmss_cost_estimate estimate;
+} candidate;
+
+static int compare_candidates(const void *a, const void *b)
+{
+    const candidate *x = a;
+    const candidate *y = b;
+
+    if (x->key != y->key) {
+        return x->key < y->key ? -1 : 1;
+    }
+    if (x->estimate.params.sig_bytes != y->estimate.params.sig_bytes) {
+        return x->estimate.params.sig_bytes < y->estimate.params.sig_bytes
+            ? -1 : 1;
+    }
+    return (x->estimate.params.sk_bytes > y->estimate.params.sk_bytes) -
+           (x->estimate.params.sk_bytes < y->estimate.params.sk_bytes);
+}
+
+static double order_key(const xmss_cost_estimate *e, xmss_cost_order order)
+{
+    switch (order) {
+        case XMSS_COST_BY_VERIFY:
+            return e->verify_ns;
+        case XMSS_COST_BY_KEYGEN:
+            return e->keygen_ns;
+        case XMSS_COST_BY_SIZE:
+            return e->params.sig_bytes;
+        default:
+            return e->sign_ns;
+    }
+}
+
+int xmss_cost_enumerate(xmss_cost_estimate *estimates, unsigned int max,
+                        const xmss_cost_model *model,
+                        const xmss_cost_limits *limits)
+{
+    static const unsigned int wots_w[] = {4, 16, 256};
+    xmss_params params;
+    xmss_cost_estimate estimate;
+    candidate *candidates = NULL;
+    candidate *grown;
+    unsigned int count = 0;
+    unsigned int capacity = 0;
+    unsigned int min_height = 1;
+    unsigned int func, n, d, w, k;
+    unsigned int tree_height;
+    unsigned int last_tree_height;
+
+    /* The last index of a key is not used, so a key of height h makes
+       2^h - 1 signatures. */
+    while (min_height < 63 &&
+           (1ULL << min_height) - 1 < limits->signatures) {
+        min_height++;
+    }
+
+    for (func = 0; func < 3; func++) {
+        for (n = 0; n < 3; n++) {
+            if (cost_n[n] < limits->min_n) {
+                continue;
+            }
+            last_tree_height = 0;
+            for (d = 1; d <= min_height; d++) {
+                tree_height = (min_height + d - 1) / d;
+                /* More layers of the same height only add costs. */
+                if (tree_height == last_tree_height ||
+                    tree_height * d > 63) {
+                    continue;
+                }
+                last_tree_height = tree_height;
+                for (w = 0; w < 3; w++) {
+                    /* The BDS treehash instances need h - k to be even. */
+                    for (k = model->bds ? tree_height % 2 : 0;
+                         k <= (model->bds ? tree_height : 0); k += 2) {
+                        if (xmss_params_custom(&params, func, cost_n[n],
+                                               tree_height * d, d,
+                                               wots_w[w], k) ||
+                            xmss_cost_estimate_params(&estimate, model,
+                                                      &params,
+                                                      limits->mlen)) {
+                            continue;
+                        }
+                        if ((limits->max_sig_bytes &&
+                             params.sig_bytes > limits->max_sig_bytes) ||
+                            (limits->max_sk_bytes &&
+                             params.sk_bytes > limits->max_sk_bytes) ||
+                            (limits->max_keygen_ns &&
+                             estimate.keygen_ns > limits->max_keygen_ns)) {
+                            continue;
+                        }
+                        if (count == capacity) {
+                            capacity = capacity ? 2 * capacity : 256;
+                            grown = realloc(candidates,
+                                            capacity * sizeof(candidate));
+                            if (grown == NULL) {
+                                free(candidates);
+                                return -1;
+                            }
+                            candidates = grown;
+                        }
+                        candidates[count].key = order_key(&estimate,
+                                                          limits->order);
+                        candidates[count].estimate = estimate;
+                        count++;
+                    }
+                }
+            }
+        }
+    }
+
+    if (count > 0) {
+        qsort(candidates, count, sizeof(candidate), compare_candidates);
+    }
+    if (count > max) {
+        count = max;
+    }
+    for (k = 0; k < count; k++) {
+        estimates[k] = candidates[k].estimate;
+    }
+    free(candidates);
+    return count;
+}
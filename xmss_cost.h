@@ -0,0 +1,96 @@
+#ifndef XMSS_COST_H
+#define XMSS_COST_H
+
+#include <stdint.h>
+#include "params.h"
+
+/**
+ * A cost model for choosing a parameter set. The cost of the hash function
+ * primitives is measured on the host, and the time of keygen, sign and
+ * verify of any set is predicted from the number of primitive calls that
+ * these operations make. Sizes are exact.
+ */
+
+/* The measured cost of each primitive for one hash function and n, in ns. */
+typedef struct {
+    double prf;
+    double prf_keygen;
+    /* A step of a WOTS chain. */
+    double thash_f;
+    double thash_h;
+    /* hash_message costs msg_fixed plus msg_byte per byte of message. */
+    double msg_fixed;
+    double msg_byte;
+} xmss_cost_primitives;
+
+typedef struct {
+    /* Indexed by func and by n: 24, 32 and 64 bytes. */
+    xmss_cost_primitives hash[3][3];
+    /* Set when the linked core keeps BDS traversal state in the key. */
+    int bds;
+} xmss_cost_model;
+
+/* The prediction for one parameter set. */
+typedef struct {
+    xmss_params params;
+    /* The RFC 8391 OID if the set has one, or else its private-use OID. */
+    uint32_t oid;
+    int mt;
+    double keygen_ns;
+    /* Signing time, averaged over the life of the key. */
+    double sign_ns;
+    double verify_ns;
+} xmss_cost_estimate;
+
+typedef enum {
+    XMSS_COST_BY_SIGN,
+    XMSS_COST_BY_VERIFY,
+    XMSS_COST_BY_KEYGEN,
+    XMSS_COST_BY_SIZE
+} xmss_cost_order;
+
+/* The requirements that xmss_cost_enumerate selects sets by. A limit of 0
+   means that there is no limit. */
+typedef struct {
+    /* The number of signatures that a key must be able to make. */
+    unsigned long long signatures;
+    unsigned long long max_sig_bytes;
+    unsigned long long max_sk_bytes;
+    double max_keygen_ns;
+    /* The smallest n, i.e. security level, to consider. */
+    unsigned int min_n;
+    /* The length of the messages, for the cost of hashing them. */
+    unsigned long long mlen;
+    xmss_cost_order order;
+} xmss_cost_limits;
+
+/**
+ * Measures the primitives of every supported hash function and n, each
+ * 'runs' times, and fills in the model.
+ * Returns -1 on failure, 0 otherwise.
+ */
+int xmss_cost_calibrate(xmss_cost_model *model, unsigned int runs);
+
+/**
+ * Predicts the cost of params, for messages of mlen bytes.
+ * Returns -1 when the model has no measurements for the hash function of
+ * params, 0 otherwise.
+ */
+int xmss_cost_estimate_params(xmss_cost_estimate *estimate,
+                              const xmss_cost_model *model,
+                              const xmss_params *params,
+                              unsigned long long mlen);
+
+/**
+ * Enumerates the sets of every hash function, n, height, number of layers,
+ * Winternitz parameter and, if the core uses BDS, bds_k, that meet the
+ * limits. Of the sets with the same tree height, only the one with the
+ * fewest layers is considered. Writes the best 'max' sets to estimates, in
+ * the order that limits selects.
+ * Returns the number of sets written, or -1 on failure.
+ */
+int xmss_cost_enumerate(xmss_cost_estimate *estimates, unsigned int max,
+                        const xmss_cost_model *model,
+                        const xmss_cost_limits *limits);
+
+#endif
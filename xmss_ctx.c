@@ -0,0 +1,250 @@
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "hash.h"
+#include "hash_address.h"
+#include "params.h"
+#include "randombytes.h"
+#include "utils.h"
+#include "wots.h"
+#include "xmss_ctx.h"
+#include "xmss_tree.h"
+
+/* The key holds just the index and 4 seeds, i.e. no BDS state. */
+static int plain_key(const xmss_params *params)
+{
+    return params->sk_bytes == params->index_bytes + 4*params->n;
+}
+
+int xmss_ctx_init(xmss_ctx *ctx, const xmss_params *params)
+{
+    unsigned long long heights_bytes;
+    unsigned char *nodes;
+
+    memset(ctx, 0, sizeof(xmss_ctx));
+    ctx->params = *params;
+    ctx->randombytes = randombytes;
+
+    /* The heights come first, so that they are aligned. */
+    heights_bytes = (params->tree_height + 1) * sizeof(unsigned int);
+    ctx->arena = calloc(1, heights_bytes + params->wots_sig_bytes +
+                           (params->tree_height + 1 + 3) * params->n);
+    if (ctx->arena == NULL) {
+        return -1;
+    }
+    ctx->heights = ctx->arena;
+    nodes = (unsigned char *)ctx->arena + heights_bytes;
+    ctx->wots = nodes;
+    ctx->stack = ctx->wots + params->wots_sig_bytes;
+    ctx->nodes = ctx->stack + (params->tree_height + 1) * params->n;
+
+    /* The pub_seed is set by every operation. */
+    thash_ctx_init(params, &ctx->thash, ctx->nodes);
+    return 0;
+}
+
+void xmss_ctx_free(xmss_ctx *ctx)
+{
+    thash_ctx_release(&ctx->thash);
+    free(ctx->arena);
+    memset(ctx, 0, sizeof(xmss_ctx));
+}
+
+int xmss_ctx_keypair(xmss_ctx *ctx, unsigned char *pk, unsigned char *sk)
+{
+    const xmss_params *params = &ctx->params;
+    unsigned char *seed = ctx->nodes;
+    uint32_t top_tree_addr[8] = {0};
+
+    if (!plain_key(params)) {
+        return -1;
+    }
+    set_layer_addr(top_tree_addr, params->d - 1);
+
+    ctx->randombytes(seed, 3 * params->n);
+
+    /* Initialize index to 0. */
+    memset(sk, 0, params->index_bytes);
+
+    /* Initialize SK_SEED and SK_PRF. */
+    memcpy(sk + params->index_bytes, seed, 2 * params->n);
+
+    /* Initialize PUB_SEED. */
+    memcpy(sk + params->index_bytes + 3*params->n, seed + 2*params->n,
+           params->n);
+    memcpy(pk + params->n, seed + 2*params->n, params->n);
+    memset(seed, 0, 3 * params->n);
+
+    /* Compute root node of the top-most subtree. */
+    thash_ctx_seed(params, &ctx->thash, pk + params->n);
+    xmss_treehash(params, &ctx->thash, pk, NULL, ctx->stack, ctx->heights,
+                  ctx->wots, sk + params->index_bytes, 0, top_tree_addr);
+    memcpy(sk + params->index_bytes + 2*params->n, pk, params->n);
+
+    return 0;
+}
+
+int xmss_ctx_sign(xmss_ctx *ctx, unsigned char *sk,
+                  unsigned char *sm, unsigned long long *smlen,
+                  const unsigned char *m, unsigned long long mlen)
+{
+    const xmss_params *params = &ctx->params;
+    const unsigned char *sk_seed = sk + params->index_bytes;
+    const unsigned char *sk_prf = sk + params->index_bytes + params->n;
+    const unsigned char *pub_root = sk + params->index_bytes + 2*params->n;
+    const unsigned char *pub_seed = sk + params->index_bytes + 3*params->n;
+    unsigned char *root = ctx->nodes;
+    unsigned char idx_bytes_32[32];
+    unsigned long long idx;
+    uint32_t idx_leaf;
+    uint32_t ots_addr[8] = {0};
+    unsigned int i;
+
+    if (!plain_key(params)) {
+        return -1;
+    }
+
+    /* Read and use the current index from the secret key. The last index
+       is left unused, as it would leave no value to mark a used-up key. */
+    idx = bytes_to_ull(sk, params->index_bytes);
+    if (idx >= (1ULL << params->full_height) - 1) {
+        return -1;
+    }
+    set_type(ots_addr, XMSS_ADDR_TYPE_OTS);
+    thash_ctx_seed(params, &ctx->thash, pub_seed);
+
+    /* Already put the message in the right place, to make it easier to
+       prepend things when computing the hash over the message. */
+    memcpy(sm + params->sig_bytes, m, mlen);
+    *smlen = params->sig_bytes + mlen;
+
+    memcpy(sm, sk, params->index_bytes);
+
+    /* Increment the index in the secret key. */
+    ull_to_bytes(sk, params->index_bytes, idx + 1);
+
+    /* Compute the digest randomization value. */
+    ull_to_bytes(idx_bytes_32, 32, idx);
+    prf_ctx(params, &ctx->thash, sm + params->index_bytes, idx_bytes_32,
+            sk_prf);
+
+    /* Compute the message hash, which the first layer signs as its 'root'. */
+    if (hash_message_ctx(params, &ctx->thash, root, sm + params->index_bytes,
+                         pub_root, idx,
+                         sm + params->sig_bytes - params->padding_len
+                            - 3*params->n,
+                         mlen)) {
+        return -1;
+    }
+    sm += params->index_bytes + params->n;
+
+    for (i = 0; i < params->d; i++) {
+        idx_leaf = (idx & (((uint32_t)1 << params->tree_height) - 1));
+        idx = idx >> params->tree_height;
+
+        set_layer_addr(ots_addr, i);
+        set_tree_addr(ots_addr, idx);
+        set_ots_addr(ots_addr, idx_leaf);
+
+        /* Compute a WOTS signature. */
+        wots_sign_ctx(params, &ctx->thash, sm, root, sk_seed, ots_addr);
+        sm += params->wots_sig_bytes;
+
+        /* Compute the authentication path for the used WOTS leaf. */
+        xmss_treehash(params, &ctx->thash, root, sm, ctx->stack, ctx->heights,
+                      ctx->wots, sk_seed, idx_leaf, ots_addr);
+        sm += params->tree_height*params->n;
+    }
+
+    return 0;
+}
+
+int xmss_ctx_open(xmss_ctx *ctx,
+                  unsigned char *m, unsigned long long *mlen,
+                  const unsigned char *sm, unsigned long long smlen,
+                  const unsigned char *pk)
+{
+    const xmss_params *params = &ctx->params;
+    const unsigned char *pub_root = pk;
+    const unsigned char *pub_seed = pk + params->n;
+    unsigned char *root = ctx->nodes;
+    unsigned long long idx;
+    uint32_t idx_leaf;
+    unsigned int i;
+
+    uint32_t ots_addr[8] = {0};
+    uint32_t ltree_addr[8] = {0};
+    uint32_t node_addr[8] = {0};
+
+    if (smlen < params->sig_bytes) {
+        return -1;
+    }
+    set_type(ots_addr, XMSS_ADDR_TYPE_OTS);
+    set_type(ltree_addr, XMSS_ADDR_TYPE_LTREE);
+    set_type(node_addr, XMSS_ADDR_TYPE_HASHTREE);
+    thash_ctx_seed(params, &ctx->thash, pub_seed);
+
+    *mlen = smlen - params->sig_bytes;
+
+    /* Convert the index bytes from the signature to an integer. */
+    idx = bytes_to_ull(sm, params->index_bytes);
+
+    /* Put the message all the way at the end of the m buffer, so that we can
+     * prepend the required other inputs for the hash function. */
+    memcpy(m + params->sig_bytes, sm + params->sig_bytes, *mlen);
+
+    /* Compute the message hash. */
+    if (hash_message_ctx(params, &ctx->thash, root, sm + params->index_bytes,
+                         pub_root, idx,
+                         m + params->sig_bytes - params->padding_len
+                            - 3*params->n,
+                         *mlen)) {
+        return -1;
+    }
+    sm += params->index_bytes + params->n;
+
+    /* For each subtree.. */
+    for (i = 0; i < params->d; i++) {
+        idx_leaf = (idx & (((uint32_t)1 << params->tree_height) - 1));
+        idx = idx >> params->tree_height;
+
+        set_layer_addr(ots_addr, i);
+        set_layer_addr(ltree_addr, i);
+        set_layer_addr(node_addr, i);
+
+        set_tree_addr(ltree_addr, idx);
+        set_tree_addr(ots_addr, idx);
+        set_tree_addr(node_addr, idx);
+
+        /* The WOTS public key is only correct if the signature was correct. */
+        set_ots_addr(ots_addr, idx_leaf);
+        /* Initially, root = mhash, but on subsequent iterations it is the root
+           of the subtree below the currently processed subtree. */
+        wots_pk_from_sig_ctx(params, &ctx->thash, ctx->wots, sm, root,
+                             ots_addr);
+        sm += params->wots_sig_bytes;
+
+        /* Compute the leaf node using the WOTS public key. */
+        set_ltree_addr(ltree_addr, idx_leaf);
+        xmss_l_tree(params, &ctx->thash, root, ctx->wots, ltree_addr);
+
+        /* Compute the root node of this subtree. */
+        xmss_climb(params, &ctx->thash, root, idx_leaf, sm,
+                   0, params->tree_height, node_addr);
+        sm += params->tree_height*params->n;
+    }
+
+    /* Check if the root node equals the root node in the public key. */
+    if (memcmp(root, pub_root, params->n)) {
+        /* If not, zero the message */
+        memset(m, 0, *mlen);
+        *mlen = 0;
+        return -1;
+    }
+
+    /* If verification was successful, copy the message from the signature. */
+    memcpy(m, sm, *mlen);
+
+    return 0;
+}
@@ -0,0 +1,77 @@
+#ifndef XMSS_CTX_H
+#define XMSS_CTX_H
+
+#include <stdint.h>
+#include "hash.h"
+#include "params.h"
+
+/**
+ * Everything that keygen, signing and verification need besides the keys:
+ * the parameters, the hash state and scratch space for WOTS keys, L-trees
+ * and treehash. It is set up once by xmss_ctx_init, after which the
+ * operations below do not allocate: the hash state is copied by assignment,
+ * and the nodes and WOTS keys are kept in the arena. What remains on the
+ * stack is bounded by the hash inputs and the wots_len chain lengths of a
+ * WOTS signature, less than 2 KB for every parameter set.
+ * A context may be used by one thread at a time; threads
+ * that each use their own context can run concurrently.
+ *
+ * The keys are those of the core functions, i.e. without OID. Signing and
+ * keygen support keys without BDS state only; verification supports all.
+ */
+typedef struct {
+    xmss_params params;
+    xmss_thash_ctx thash;
+    /* The source of the seeds of xmss_ctx_keypair; randombytes by default. */
+    void (*randombytes)(unsigned char *x, unsigned long long xlen);
+    /* A single allocation, sliced into the scratch areas below. */
+    void *arena;
+    /* The tree heights of the nodes on the treehash stack. */
+    unsigned int *heights;
+    /* A WOTS public key of wots_len nodes, consumed by the L-tree. */
+    unsigned char *wots;
+    /* The treehash stack of tree_height + 1 nodes. */
+    unsigned char *stack;
+    /* Three nodes: the seeds of a new key, or the root that signing and
+       verification carry from layer to layer. */
+    unsigned char *nodes;
+} xmss_ctx;
+
+/**
+ * Prepares ctx for the parameters params, which are copied.
+ * Returns -1 when memory runs out, 0 otherwise.
+ */
+int xmss_ctx_init(xmss_ctx *ctx, const xmss_params *params);
+
+/* Releases everything that xmss_ctx_init allocated. */
+void xmss_ctx_free(xmss_ctx *ctx);
+
+/**
+ * Generates a keypair as xmssmt_core_keypair does, drawing the seeds from
+ * ctx->randombytes. Only the top tree is computed.
+ * Returns -1 for parameters that keep BDS state in the key, 0 otherwise.
+ */
+int xmss_ctx_keypair(xmss_ctx *ctx, unsigned char *pk, unsigned char *sk);
+
+/**
+ * Signs the message m of length mlen as xmssmt_core_sign does, and updates
+ * the index in sk. sm must have room for sig_bytes + mlen bytes.
+ * Returns -1 when all signatures of the key have been used, or for
+ * parameters that keep BDS state in the key, 0 otherwise.
+ */
+int xmss_ctx_sign(xmss_ctx *ctx, unsigned char *sk,
+                  unsigned char *sm, unsigned long long *smlen,
+                  const unsigned char *m, unsigned long long mlen);
+
+/**
+ * Verifies the signed message sm of length smlen under pk, as
+ * xmssmt_core_sign_open does. m must have room for smlen bytes; for a valid
+ * signature, the message is at its start and its length is written to mlen.
+ * Returns 0 if the signature is valid, -1 otherwise.
+ */
+int xmss_ctx_open(xmss_ctx *ctx,
+                  unsigned char *m, unsigned long long *mlen,
+                  const unsigned char *sm, unsigned long long smlen,
+                  const unsigned char *pk);
+
+#endif
@@ -0,0 +1,112 @@
+#include <stdint.h>
+
+#include "params.h"
+#include "utils.h"
+#include "xmss_core_steps.h"
+#include "xmss_detached.h"
+#include "xmss_verify_stream.h"
+
+int xmssmt_core_sign_detached(const xmss_params *params, unsigned char *sk,
+                              unsigned char *sig,
+                              const unsigned char *m, unsigned long long mlen)
+{
+    xmss_sign_state state;
+
+    if (xmssmt_core_sign_msg_init(params, &state, sk, sig)) {
+        return -1;
+    }
+    if (xmssmt_core_sign_msg_update(&state, m, mlen)) {
+        xmssmt_core_sign_msg_final(&state);
+        return -1;
+    }
+    if (xmssmt_core_sign_msg_final(&state)) {
+        return -1;
+    }
+    return xmssmt_core_sign_finish(&state);
+}
+
+int xmssmt_core_verify_detached(const xmss_params *params,
+                                const unsigned char *sig,
+                                const unsigned char *m, unsigned long long mlen,
+                                const unsigned char *pk)
+{
+    xmss_verify_stream state;
+    unsigned long long header = params->index_bytes + params->n;
+
+    if (xmssmt_core_verify_begin(params, &state, pk)) {
+        return -1;
+    }
+    /* The message hash needs R and the index, which start the signature. */
+    xmssmt_core_verify_sig_update(&state, sig, header);
+    xmssmt_core_verify_msg_update(&state, m, mlen);
+    xmssmt_core_verify_msg_final(&state);
+    xmssmt_core_verify_sig_update(&state, sig + header,
+                                  params->sig_bytes - header);
+    return xmssmt_core_verify_finish(&state);
+}
+
+int xmss_core_sign_detached(const xmss_params *params, unsigned char *sk,
+                            unsigned char *sig,
+                            const unsigned char *m, unsigned long long mlen)
+{
+    return xmssmt_core_sign_detached(params, sk, sig, m, mlen);
+}
+
+int xmss_core_verify_detached(const xmss_params *params,
+                              const unsigned char *sig,
+                              const unsigned char *m, unsigned long long mlen,
+                              const unsigned char *pk)
+{
+    return xmssmt_core_verify_detached(params, sig, m, mlen, pk);
+}
+
+int xmss_sign_detached(unsigned char *sk, unsigned char *sig,
+                       const unsigned char *m, unsigned long long mlen)
+{
+    xmss_params params;
+    uint32_t oid = (uint32_t)bytes_to_ull(sk, XMSS_OID_LEN);
+
+    if (xmss_parse_oid(&params, oid)) {
+        return -1;
+    }
+    return xmss_core_sign_detached(&params, sk + XMSS_OID_LEN, sig, m, mlen);
+}
+
+int xmss_verify_detached(const unsigned char *sig,
+                         const unsigned char *m, unsigned long long mlen,
+                         const unsigned char *pk)
+{
+    xmss_params params;
+    uint32_t oid = (uint32_t)bytes_to_ull(pk, XMSS_OID_LEN);
+
+    if (xmss_parse_oid(&params, oid)) {
+        return -1;
+    }
+    return xmss_core_verify_detached(&params, sig, m, mlen, pk + XMSS_OID_LEN);
+}
+
+int xmssmt_sign_detached(unsigned char *sk, unsigned char *sig,
+                         const unsigned char *m, unsigned long long mlen)
+{
+    xmss_params params;
+    uint32_t oid = (uint32_t)bytes_to_ull(sk, XMSS_OID_LEN);
+
+    if (xmssmt_parse_oid(&params, oid)) {
+        return -1;
+    }
+    return xmssmt_core_sign_detached(&params, sk + XMSS_OID_LEN, sig, m, mlen);
+}
+
+int xmssmt_verify_detached(const unsigned char *sig,
+                           const unsigned char *m, unsigned long long mlen,
+                           const unsigned char *pk)
+{
+    xmss_params params;
+    uint32_t oid = (uint32_t)bytes_to_ull(pk, XMSS_OID_LEN);
+
+    if (xmssmt_parse_oid(&params, oid)) {
+        return -1;
+    }
+    return xmssmt_core_verify_detached(&params, sig, m, mlen,
+                                       pk + XMSS_OID_LEN);
+}
@@ -0,0 +1,65 @@
+#ifndef XMSS_DETACHED_H
+#define XMSS_DETACHED_H
+
+#include <stdint.h>
+#include "params.h"
+
+/**
+ * Signs the message m of length mlen, and writes only the signature of
+ * params->sig_bytes bytes to sig; the message is neither copied nor
+ * prepended. The index is read from and incremented in sk, as with
+ * xmssmt_core_sign, and sk has to be stored before the signature is
+ * released. As the signature is computed by the step-wise signer, sk has
+ * to be a key without state beyond its index, i.e. not one of the BDS core.
+ * For messages that are not in memory at once, use xmssmt_core_sign_msg_init
+ * and its companions from xmss_core_steps.h directly.
+ * Returns -1 for a key with BDS state or a used-up key, which are left
+ * unchanged, 0 otherwise.
+ */
+int xmssmt_core_sign_detached(const xmss_params *params, unsigned char *sk,
+                              unsigned char *sig,
+                              const unsigned char *m, unsigned long long mlen);
+
+/**
+ * Verifies the signature sig of params->sig_bytes bytes on the message m of
+ * length mlen under pk (without OID). The message is read in place.
+ * For messages that are not in memory at once, use the streaming verifier
+ * of xmss_verify_stream.h directly.
+ * Returns 0 if the signature is valid, -1 otherwise.
+ */
+int xmssmt_core_verify_detached(const xmss_params *params,
+                                const unsigned char *sig,
+                                const unsigned char *m, unsigned long long mlen,
+                                const unsigned char *pk);
+
+/*
+ * The XMSS variants. As XMSS is XMSS^MT with d = 1, these only differ in name.
+ */
+int xmss_core_sign_detached(const xmss_params *params, unsigned char *sk,
+                            unsigned char *sig,
+                            const unsigned char *m, unsigned long long mlen);
+
+int xmss_core_verify_detached(const xmss_params *params,
+                              const unsigned char *sig,
+                              const unsigned char *m, unsigned long long mlen,
+                              const unsigned char *pk);
+
+/**
+ * As above, but for a secret or public key that starts with its OID.
+ * The signature is params->sig_bytes bytes for the parameters of the OID.
+ */
+int xmss_sign_detached(unsigned char *sk, unsigned char *sig,
+                       const unsigned char *m, unsigned long long mlen);
+
+int xmss_verify_detached(const unsigned char *sig,
+                         const unsigned char *m, unsigned long long mlen,
+                         const unsigned char *pk);
+
+int xmssmt_sign_detached(unsigned char *sk, unsigned char *sig,
+                         const unsigned char *m, unsigned long long mlen);
+
+int xmssmt_verify_detached(const unsigned char *sig,
+                           const unsigned char *m, unsigned long long mlen,
+                           const unsigned char *pk);
+
+#endif
@@ -0,0 +1,456 @@
+#include <pthread.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "hash.h"
+#include "hash_address.h"
+#include "params.h"
+#include "wots.h"
+#include "utils.h"
+#include "xmss_pool.h"
+#include "xmss_tree.h"
+
+struct xmss_pool {
+    xmss_params params;
+    unsigned char *sk;
+    /* Prepared leaves for the indices head_idx .. head_idx + count - 1, in
+       the slots starting at 'head' of the ring of 'size' entries. */
+    unsigned char *entries;
+    unsigned long long entry_bytes;
+    /* Bottom-layer WOTS keys are stored with checkpoints every 'interval'
+       chain positions, taking up the first cp_bytes of an entry. */
+    unsigned int interval;
+    unsigned long long cp_bytes;
+    unsigned int size;
+    unsigned int head;
+    unsigned int count;
+    unsigned long long head_idx;
+    /* The last index that is signed; as in xmss_ctx_sign, the very last
+       index of the key is left unused. */
+    unsigned long long max_idx;
+    /* Incremented whenever prepared leaves are discarded. */
+    unsigned long generation;
+    /* Buffers of the background thread. */
+    unsigned char *work_entry;
+    unsigned char *work_upper;
+    unsigned char *work_top;
+    unsigned char *work_block;
+    int stop;
+    pthread_mutex_t lock;
+    pthread_cond_t ready;
+    pthread_cond_t space;
+    pthread_t thread;
+};
+
+/**
+ * What the background thread keeps across the leaves it prepares, all of
+ * which is only recomputed when it no longer applies. The bottom subtree
+ * 'tree' is split at height 'split': its nodes from there up are kept in
+ * 'top', and those below in 'block' for the 2^split leaves that start at
+ * block_first. Both are heaps, in which node k has the children 2k and
+ * 2k + 1. 'upper' holds the signature parts of the upper layers.
+ */
+typedef struct {
+    unsigned long long tree;
+    uint32_t block_first;
+    unsigned int split;
+    unsigned char *top;
+    unsigned char *block;
+    unsigned char *upper;
+} leaf_cache;
+
+/**
+ * Hashes the nodes of the heap of the given height together, up to its root
+ * at position 1. Its leaves are at height 'base' of the subtree at addr, and
+ * the first of them has index 'first' there.
+ */
+static void heap_hash(const xmss_params *params, xmss_thash_ctx *ctx,
+                      unsigned char *nodes, unsigned int height,
+                      unsigned int base, uint32_t first,
+                      const uint32_t subtree_addr[8])
+{
+    uint32_t node_addr[8] = {0};
+    unsigned int level;
+    uint32_t j;
+    uint32_t k;
+
+    copy_subtree_addr(node_addr, subtree_addr);
+    set_type(node_addr, XMSS_ADDR_TYPE_HASHTREE);
+
+    for (level = 0; level < height; level++) {
+        set_tree_height(node_addr, base + level);
+        for (j = 0; j < (uint32_t)1 << (height - level - 1); j++) {
+            k = ((uint32_t)1 << (height - level - 1)) + j;
+            set_tree_index(node_addr, (first >> (base + level + 1)) + j);
+            thash_h_ctx(params, ctx, nodes + k*params->n,
+                        nodes + 2*k*params->n, node_addr);
+        }
+    }
+}
+
+/**
+ * Computes all nodes of the 2^height leaves that start at leaf 'first' of
+ * the subtree at subtree_addr, as a heap of 2^(height + 1) nodes.
+ */
+static void heap_leaves(const xmss_params *params, xmss_thash_ctx *ctx,
+                        unsigned char *nodes, const unsigned char *sk_seed,
+                        uint32_t first, unsigned int height,
+                        const uint32_t subtree_addr[8])
+{
+    unsigned char wots_pk[params->wots_sig_bytes];
+    uint32_t ots_addr[8] = {0};
+    uint32_t ltree_addr[8] = {0};
+    uint32_t i;
+
+    copy_subtree_addr(ots_addr, subtree_addr);
+    copy_subtree_addr(ltree_addr, subtree_addr);
+    set_type(ots_addr, XMSS_ADDR_TYPE_OTS);
+    set_type(ltree_addr, XMSS_ADDR_TYPE_LTREE);
+
+    for (i = 0; i < (uint32_t)1 << height; i++) {
+        set_ots_addr(ots_addr, first + i);
+        set_ltree_addr(ltree_addr, first + i);
+        wots_pkgen_ctx(params, ctx, wots_pk, sk_seed, ots_addr);
+        xmss_l_tree(params, ctx,
+                    nodes + (((uint32_t)1 << height) + i)*params->n,
+                    wots_pk, ltree_addr);
+    }
+    heap_hash(params, ctx, nodes, height, 0, first, subtree_addr);
+}
+
+/**
+ * Prepares the leaf for index idx. An entry consists of the bottom layer
+ * WOTS private key with its chain checkpoints, followed by the bottom
+ * authentication path and the signature parts of all upper layers.
+ * When the bottom subtree changes, all of its nodes from height
+ * cache->split up are computed; below that, only the nodes of the block of
+ * leaves of idx are. The upper layers are recomputed along with the former.
+ * ctx holds the pub_seed of sk.
+ */
+static void prepare_leaf(const xmss_params *params, xmss_thash_ctx *ctx,
+                         const unsigned char *sk, unsigned int interval,
+                         unsigned char *entry, unsigned long long idx,
+                         leaf_cache *cache)
+{
+    const unsigned char *sk_seed = sk + params->index_bytes;
+    const unsigned char *pub_seed = sk + params->index_bytes + 3*params->n;
+    unsigned long long upper_bytes = (params->d - 1) *
+        (params->wots_sig_bytes + params->tree_height*params->n);
+    unsigned int split = cache->split;
+    uint32_t blocks = (uint32_t)1 << (params->tree_height - split);
+    unsigned char root[params->n];
+    unsigned char stack[(params->tree_height + 1)*params->n];
+    unsigned int heights[params->tree_height + 1];
+    unsigned char wots_pk[params->wots_sig_bytes];
+    unsigned char *sig = cache->upper;
+    unsigned long long tree;
+    uint32_t idx_leaf;
+    uint32_t first;
+    uint32_t block;
+    uint32_t b;
+    uint32_t k;
+    uint32_t ots_addr[8] = {0};
+    unsigned int i;
+
+    set_type(ots_addr, XMSS_ADDR_TYPE_OTS);
+
+    idx_leaf = (idx & (((uint32_t)1 << params->tree_height) - 1));
+    idx = idx >> params->tree_height;
+    tree = idx;
+
+    set_layer_addr(ots_addr, 0);
+    set_tree_addr(ots_addr, idx);
+    set_ots_addr(ots_addr, idx_leaf);
+
+    wots_checkpoints(params, entry, sk_seed, pub_seed, ots_addr, interval);
+    entry += params->wots_len * wots_checkpoint_count(params, interval)
+             * params->n;
+
+    first = idx_leaf >> split << split;
+    if (cache->tree != tree) {
+        /* The block of idx_leaf comes last, so that it remains in block. */
+        for (b = 1; b <= blocks; b++) {
+            block = ((first >> split) + b) % blocks;
+            heap_leaves(params, ctx, cache->block, sk_seed, block << split,
+                        split, ots_addr);
+            memcpy(cache->top + (blocks + block)*params->n,
+                   cache->block + params->n, params->n);
+        }
+        heap_hash(params, ctx, cache->top, params->tree_height - split, split,
+                  0, ots_addr);
+        cache->block_first = first;
+    }
+    else if (cache->block_first != first) {
+        heap_leaves(params, ctx, cache->block, sk_seed, first, split,
+                    ots_addr);
+        cache->block_first = first;
+    }
+
+    /* The authentication path consists of the siblings on the way up. */
+    k = ((uint32_t)1 << split) + (idx_leaf - first);
+    for (i = 0; i < split; i++) {
+        memcpy(entry + i*params->n, cache->block + (k ^ 1)*params->n,
+               params->n);
+        k >>= 1;
+    }
+    k = blocks + (idx_leaf >> split);
+    for (; i < params->tree_height; i++) {
+        memcpy(entry + i*params->n, cache->top + (k ^ 1)*params->n,
+               params->n);
+        k >>= 1;
+    }
+    entry += params->tree_height*params->n;
+
+    if (cache->tree != tree) {
+        memcpy(root, cache->top + params->n, params->n);
+        for (i = 1; i < params->d; i++) {
+            idx_leaf = (idx & (((uint32_t)1 << params->tree_height) - 1));
+            idx = idx >> params->tree_height;
+
+            set_layer_addr(ots_addr, i);
+            set_tree_addr(ots_addr, idx);
+            set_ots_addr(ots_addr, idx_leaf);
+
+            wots_sign_ctx(params, ctx, sig, root, sk_seed, ots_addr);
+            sig += params->wots_sig_bytes;
+            xmss_treehash(params, ctx, root, sig, stack, heights, wots_pk,
+                          sk_seed, idx_leaf, ots_addr);
+            sig += params->tree_height*params->n;
+        }
+        cache->tree = tree;
+    }
+    memcpy(entry, cache->upper, upper_bytes);
+}
+
+static unsigned char *pool_entry(xmss_pool *pool, unsigned int i)
+{
+    return pool->entries + ((pool->head + i) % pool->size) * pool->entry_bytes;
+}
+
+/* Background thread that keeps the ring of prepared leaves filled. */
+static void *prepare_leaves(void *arg)
+{
+    xmss_pool *pool = arg;
+    const xmss_params *params = &pool->params;
+    unsigned char *entry = pool->work_entry;
+    leaf_cache cache;
+    unsigned long long idx;
+    unsigned long generation;
+    xmss_thash_ctx thash;
+
+    cache.tree = (unsigned long long)-1;
+    cache.block_first = 0;
+    cache.split = params->tree_height / 2;
+    cache.top = pool->work_top;
+    cache.block = pool->work_block;
+    cache.upper = pool->work_upper;
+
+    thash_ctx_init(params, &thash,
+                   pool->sk + params->index_bytes + 3*params->n);
+    pthread_mutex_lock(&pool->lock);
+    while (!pool->stop) {
+        idx = pool->head_idx + pool->count;
+        if (pool->count == pool->size || idx > pool->max_idx) {
+            pthread_cond_wait(&pool->space, &pool->lock);
+            continue;
+        }
+        generation = pool->generation;
+        pthread_mutex_unlock(&pool->lock);
+
+        prepare_leaf(params, &thash, pool->sk, pool->interval, entry, idx,
+                     &cache);
+
+        pthread_mutex_lock(&pool->lock);
+        /* Only keep the result if the ring was not reset in the meantime. */
+        if (generation == pool->generation) {
+            memcpy(pool_entry(pool, pool->count), entry, pool->entry_bytes);
+            pool->count++;
+            pthread_cond_broadcast(&pool->ready);
+        }
+    }
+    pthread_mutex_unlock(&pool->lock);
+    thash_ctx_release(&thash);
+
+    return NULL;
+}
+
+xmss_pool *xmss_pool_create(const xmss_params *params,
+                            const unsigned char *sk, unsigned int size,
+                            unsigned int interval)
+{
+    xmss_pool *pool;
+
+    if (size == 0) {
+        return NULL;
+    }
+    /* The pool only advances the index, which would leave BDS state stale. */
+    if (params->sk_bytes != params->index_bytes + 4*params->n) {
+        return NULL;
+    }
+    if (interval == 0 || interval > params->wots_w) {
+        interval = params->wots_w;
+    }
+    pool = calloc(1, sizeof(xmss_pool));
+    if (pool == NULL) {
+        return NULL;
+    }
+    pool->params = *params;
+    pool->size = size;
+    pool->interval = interval;
+    pool->cp_bytes = params->wots_len * wots_checkpoint_count(params, interval)
+                     * params->n;
+    pool->entry_bytes = pool->cp_bytes + params->sig_bytes
+                        - params->index_bytes - params->n
+                        - params->wots_sig_bytes;
+    pool->head_idx = bytes_to_ull(sk, params->index_bytes);
+    pool->max_idx = (1ULL << params->full_height) - 2;
+    pool->sk = malloc(params->sk_bytes);
+    pool->entries = malloc(size * pool->entry_bytes);
+    pool->work_entry = malloc(pool->entry_bytes);
+    pool->work_upper = malloc(pool->entry_bytes);
+    /* The halves of the bottom subtree, split as in prepare_leaves. */
+    pool->work_top = malloc((2ULL << (params->tree_height
+                                      - params->tree_height / 2)) * params->n);
+    pool->work_block = malloc((2ULL << (params->tree_height / 2)) * params->n);
+    if (pool->sk == NULL || pool->entries == NULL ||
+        pool->work_entry == NULL || pool->work_upper == NULL ||
+        pool->work_top == NULL || pool->work_block == NULL) {
+        free(pool->sk);
+        free(pool->entries);
+        free(pool->work_entry);
+        free(pool->work_upper);
+        free(pool->work_top);
+        free(pool->work_block);
+        free(pool);
+        return NULL;
+    }
+    memcpy(pool->sk, sk, params->sk_bytes);
+
+    pthread_mutex_init(&pool->lock, NULL);
+    pthread_cond_init(&pool->ready, NULL);
+    pthread_cond_init(&pool->space, NULL);
+    if (pthread_create(&pool->thread, NULL, prepare_leaves, pool)) {
+        pool->thread = pthread_self();
+        xmss_pool_destroy(pool);
+        return NULL;
+    }
+    return pool;
+}
+
+void xmss_pool_destroy(xmss_pool *pool)
+{
+    pthread_mutex_lock(&pool->lock);
+    pool->stop = 1;
+    pthread_cond_broadcast(&pool->space);
+    pthread_mutex_unlock(&pool->lock);
+    if (!pthread_equal(pool->thread, pthread_self())) {
+        pthread_join(pool->thread, NULL);
+    }
+
+    pthread_mutex_destroy(&pool->lock);
+    pthread_cond_destroy(&pool->ready);
+    pthread_cond_destroy(&pool->space);
+
+    memset(pool->sk, 0, pool->params.sk_bytes);
+    memset(pool->entries, 0, pool->size * pool->entry_bytes);
+    memset(pool->work_entry, 0, pool->entry_bytes);
+    free(pool->sk);
+    free(pool->entries);
+    free(pool->work_entry);
+    free(pool->work_upper);
+    free(pool->work_top);
+    free(pool->work_block);
+    free(pool);
+}
+
+int xmssmt_pool_sign(xmss_pool *pool, unsigned char *sk,
+                     unsigned char *sm, unsigned long long *smlen,
+                     const unsigned char *m, unsigned long long mlen)
+{
+    const xmss_params *params = &pool->params;
+    const unsigned char *sk_prf = sk + params->index_bytes + params->n;
+    const unsigned char *pub_root = sk + params->index_bytes + 2*params->n;
+    const unsigned char *pub_seed = sk + params->index_bytes + 3*params->n;
+
+    unsigned char cp[pool->cp_bytes];
+    unsigned char mhash[params->n];
+    xmss_hash_msg_ctx hash;
+    unsigned long long idx;
+    unsigned char idx_bytes_32[32];
+    uint32_t ots_addr[8] = {0};
+
+    idx = bytes_to_ull(sk, params->index_bytes);
+    if (idx > pool->max_idx) {
+        return -1;
+    }
+
+    memcpy(sm + params->sig_bytes, m, mlen);
+    *smlen = params->sig_bytes + mlen;
+
+    memcpy(sm, sk, params->index_bytes);
+
+    /* Increment the index in the secret key. */
+    ull_to_bytes(sk, params->index_bytes, idx + 1);
+
+    /* Compute the digest randomization value. */
+    ull_to_bytes(idx_bytes_32, 32, idx);
+    prf(params, sm + params->index_bytes, idx_bytes_32, sk_prf);
+
+    /* Compute the message hash. */
+    if (hash_message_init(params, &hash, sm + params->index_bytes, pub_root,
+                          idx)) {
+        return -1;
+    }
+    if (hash_message_update(params, &hash, m, mlen)) {
+        hash_message_final(params, &hash, mhash);
+        return -1;
+    }
+    if (hash_message_final(params, &hash, mhash)) {
+        return -1;
+    }
+
+    pthread_mutex_lock(&pool->lock);
+    /* Drop leaves whose index has already been used. */
+    while (pool->count > 0 && pool->head_idx < idx) {
+        pool->head = (pool->head + 1) % pool->size;
+        pool->head_idx++;
+        pool->count--;
+    }
+    /* If sk has moved outside of the prepared range, start over there. */
+    if (pool->head_idx != idx) {
+        pool->head_idx = idx;
+        pool->count = 0;
+        pool->generation++;
+    }
+    pthread_cond_broadcast(&pool->space);
+    while (pool->count == 0) {
+        pthread_cond_wait(&pool->ready, &pool->lock);
+    }
+    memcpy(cp, pool_entry(pool, 0), pool->cp_bytes);
+    memcpy(sm + params->index_bytes + params->n + params->wots_sig_bytes,
+           pool_entry(pool, 0) + pool->cp_bytes,
+           pool->entry_bytes - pool->cp_bytes);
+    pool->head = (pool->head + 1) % pool->size;
+    pool->head_idx++;
+    pool->count--;
+    pthread_cond_broadcast(&pool->space);
+    pthread_mutex_unlock(&pool->lock);
+
+    /* Only the bottom layer WOTS signature depends on the message. */
+    set_type(ots_addr, XMSS_ADDR_TYPE_OTS);
+    set_layer_addr(ots_addr, 0);
+    set_tree_addr(ots_addr, idx >> params->tree_height);
+    set_ots_addr(ots_addr, idx & (((uint32_t)1 << params->tree_height) - 1));
+    wots_sign_checkpoints(params, sm + params->index_bytes + params->n, mhash,
+                          cp, pool->interval, pub_seed, ots_addr);
+
+    return 0;
+}
+
+int xmss_pool_sign(xmss_pool *pool, unsigned char *sk,
+                   unsigned char *sm, unsigned long long *smlen,
+                   const unsigned char *m, unsigned long long mlen)
+{
+    return xmssmt_pool_sign(pool, sk, sm, smlen, m, mlen);
+}
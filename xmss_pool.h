@@ -0,0 +1,58 @@
+#ifndef XMSS_POOL_H
+#define XMSS_POOL_H
+
+#include "params.h"
+
+/**
+ * A pool of prepared signing leaves. A background thread keeps the next
+ * 'size' indices ready: for each of them it stores the expanded WOTS private
+ * key of the bottom layer and all of the signature that does not depend on
+ * the message, i.e. the authentication paths and the WOTS signatures of the
+ * upper XMSS^MT layers. What remains online is computing R, the message
+ * hash and the partial WOTS chains of the bottom layer.
+ *
+ * The bottom-layer chains can additionally be prepared with checkpoints
+ * every 'interval' positions (see wots_checkpoints), so that the online
+ * chain walks start from the nearest checkpoint instead of from the start.
+ * With an interval of w/2, this halves the expected online hash count at
+ * the cost of storing two chain values per chain for every prepared leaf.
+ *
+ * The pool applies to secret keys that hold just the index and the seeds.
+ * Keys of the BDS core are refused, as signing through the pool only
+ * advances the index and would leave their BDS state stale.
+ */
+typedef struct xmss_pool xmss_pool;
+
+/**
+ * Creates a pool for the secret key sk (without OID) and starts preparing
+ * the indices that follow the one currently stored in it. An interval of 0
+ * or w disables the chain checkpoints.
+ * Returns NULL on failure, and for a key that keeps BDS state.
+ */
+xmss_pool *xmss_pool_create(const xmss_params *params,
+                            const unsigned char *sk, unsigned int size,
+                            unsigned int interval);
+
+/**
+ * Stops the background thread, clears all prepared key material and frees
+ * the pool.
+ */
+void xmss_pool_destroy(xmss_pool *pool);
+
+/**
+ * Signs a message using the leaf prepared for the index in sk, waiting for
+ * it if it is not ready yet. The output, as well as the update of sk, are
+ * identical to those of xmssmt_core_sign. If sk has been used outside the
+ * pool, the pool moves on to the index in sk.
+ * Returns -1 when all signatures of the key have been used, 0 otherwise.
+ */
+int xmssmt_pool_sign(xmss_pool *pool, unsigned char *sk,
+                     unsigned char *sm, unsigned long long *smlen,
+                     const unsigned char *m, unsigned long long mlen);
+
+/* The XMSS variant; XMSS is XMSS^MT with d = 1. */
+int xmss_pool_sign(xmss_pool *pool, unsigned char *sk,
+                   unsigned char *sm, unsigned long long *smlen,
+                   const unsigned char *m, unsigned long long mlen);
+
+#endif
@@ -0,0 +1,74 @@
+#include <time.h>
+
+#include "xmss_trace.h"
+
+#ifdef XMSS_TRACE_USDT
+#include <sys/sdt.h>
+#endif
+
+static xmss_trace_callback trace_callback;
+static void *trace_arg;
+
+static const char *phase_names[XMSS_PHASES] = {
+    "sign_msg_hash",
+    "sign_wots",
+    "sign_auth_path",
+    "sign_upper_layers",
+    "sign_state",
+    "verify_msg_hash",
+    "verify_wots",
+    "verify_ltree",
+    "verify_root",
+};
+
+void xmss_trace_set_callback(xmss_trace_callback callback, void *arg)
+{
+    trace_arg = arg;
+    trace_callback = callback;
+}
+
+const char *xmss_phase_name(xmss_phase phase)
+{
+    if (phase >= XMSS_PHASES) {
+        return "unknown";
+    }
+    return phase_names[phase];
+}
+
+void xmss_trace_histogram_record(void *arg, xmss_phase phase,
+                                 unsigned long long ns)
+{
+    xmss_trace_histogram *histogram = arg;
+    unsigned int bucket = 0;
+
+    while (bucket < XMSS_TRACE_BUCKETS - 1 && (ns >> (bucket + 1))) {
+        bucket++;
+    }
+    __atomic_fetch_add(&histogram->counts[phase][bucket], 1,
+                       __ATOMIC_RELAXED);
+}
+
+unsigned long long xmss_trace_now(void)
+{
+    struct timespec t;
+
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return (unsigned long long)t.tv_sec * 1000000000ULL + t.tv_nsec;
+}
+
+void xmss_trace_emit(const xmss_trace *trace)
+{
+    unsigned int i;
+
+    for (i = 0; i < XMSS_PHASES; i++) {
+        if (trace->ns[i] == 0) {
+            continue;
+        }
+#ifdef XMSS_TRACE_USDT
+        DTRACE_PROBE2(xmss, phase, i, trace->ns[i]);
+#endif
+        if (trace_callback != NULL) {
+            trace_callback(trace_arg, (xmss_phase)i, trace->ns[i]);
+        }
+    }
+}
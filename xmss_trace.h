@@ -0,0 +1,83 @@
+#ifndef XMSS_TRACE_H
+#define XMSS_TRACE_H
+
+/**
+ * Per-phase latency tracing of sign and verify calls, which is only compiled
+ * in with -DXMSS_TRACE. Each call accumulates the time it spends in each of
+ * its phases, and reports the durations once it completes: to the callback
+ * set with xmss_trace_set_callback, and, when also compiled with
+ * -DXMSS_TRACE_USDT, as the USDT probe xmss:phase(phase, ns) for perf and
+ * bpftrace. Only the phases that a call went through are reported.
+ *
+ * Traced are the step-wise signer of xmss_core_steps.h, and with it the
+ * detached signer, and the verifier of xmss_verify.h.
+ */
+
+/* The phases that are timed. */
+typedef enum {
+    XMSS_PHASE_SIGN_MSG_HASH,
+    XMSS_PHASE_SIGN_WOTS,
+    XMSS_PHASE_SIGN_AUTH_PATH,
+    XMSS_PHASE_SIGN_UPPER_LAYERS,
+    XMSS_PHASE_SIGN_STATE,
+    XMSS_PHASE_VERIFY_MSG_HASH,
+    XMSS_PHASE_VERIFY_WOTS,
+    XMSS_PHASE_VERIFY_LTREE,
+    XMSS_PHASE_VERIFY_ROOT,
+    XMSS_PHASES
+} xmss_phase;
+
+/* The durations of the phases of one call, in nanoseconds. */
+typedef struct {
+    unsigned long long ns[XMSS_PHASES];
+    unsigned long long start;
+} xmss_trace;
+
+/**
+ * Receives the duration of one phase of a completed call. It is called from
+ * the thread that made the call, and may thus be called concurrently.
+ */
+typedef void (*xmss_trace_callback)(void *arg, xmss_phase phase,
+                                    unsigned long long ns);
+
+/**
+ * Sets the callback for all threads, or removes it when NULL. It should be
+ * set before any traced call is made.
+ */
+void xmss_trace_set_callback(xmss_trace_callback callback, void *arg);
+
+/* Returns a name such as "sign_wots" for a phase. */
+const char *xmss_phase_name(xmss_phase phase);
+
+/* Number of buckets of a histogram; bucket i counts durations in
+   [2^i, 2^(i+1)) ns, and bucket 0 also those of 0 ns. */
+#define XMSS_TRACE_BUCKETS 48
+
+typedef struct {
+    unsigned long long counts[XMSS_PHASES][XMSS_TRACE_BUCKETS];
+} xmss_trace_histogram;
+
+/**
+ * A callback that records each duration in the xmss_trace_histogram that is
+ * passed as arg. It may be used from several threads at once.
+ */
+void xmss_trace_histogram_record(void *arg, xmss_phase phase,
+                                 unsigned long long ns);
+
+/* Used by the traced functions. */
+unsigned long long xmss_trace_now(void);
+
+void xmss_trace_emit(const xmss_trace *trace);
+
+#ifdef XMSS_TRACE
+#define XMSS_TRACE_START(t) ((t)->start = xmss_trace_now())
+#define XMSS_TRACE_STOP(t, phase) \
+    ((t)->ns[(phase)] += xmss_trace_now() - (t)->start)
+#define XMSS_TRACE_EMIT(t) xmss_trace_emit(t)
+#else
+#define XMSS_TRACE_START(t) ((void)(t))
+#define XMSS_TRACE_STOP(t, phase) ((void)(t))
+#define XMSS_TRACE_EMIT(t) ((void)(t))
+#endif
+
+#endif
@@ -0,0 +1,148 @@
+#include <stdint.h>
+#include <string.h>
+
+#include "hash.h"
+#include "hash_address.h"
+#include "params.h"
+#include "wots.h"
+#include "xmss_tree.h"
+
+void xmss_l_tree(const xmss_params *params, xmss_thash_ctx *ctx,
+                 unsigned char *leaf, unsigned char *wots_pk,
+                 uint32_t addr[8])
+{
+    unsigned int l = params->wots_len;
+    unsigned int parent_nodes;
+    uint32_t i;
+    uint32_t height = 0;
+
+    set_tree_height(addr, height);
+
+    while (l > 1) {
+        parent_nodes = l >> 1;
+        for (i = 0; i < parent_nodes; i++) {
+            set_tree_index(addr, i);
+            /* Hashes the nodes at (i*2)*params->n and (i*2)*params->n + 1 */
+            thash_h_ctx(params, ctx, wots_pk + i*params->n,
+                        wots_pk + (i*2)*params->n, addr);
+        }
+        /* If the row contained an odd number of nodes, the last node was not
+           hashed. Instead, we pull it up to the next layer. */
+        if (l & 1) {
+            memcpy(wots_pk + (l >> 1)*params->n,
+                   wots_pk + (l - 1)*params->n, params->n);
+            l = (l >> 1) + 1;
+        }
+        else {
+            l = l >> 1;
+        }
+        height++;
+        set_tree_height(addr, height);
+    }
+    memcpy(leaf, wots_pk, params->n);
+}
+
+void xmss_climb(const xmss_params *params, xmss_thash_ctx *ctx,
+                unsigned char *node, uint32_t leafidx,
+                const unsigned char *auth_path,
+                unsigned int from, unsigned int to, uint32_t addr[8])
+{
+    unsigned char buffer[2*params->n];
+    unsigned int i;
+
+    for (i = from; i < to; i++) {
+        /* If the node is a right child (its index is odd), the node of the
+           auth path goes left. Otherwise it is the other way around. */
+        if ((leafidx >> i) & 1) {
+            memcpy(buffer, auth_path + i*params->n, params->n);
+            memcpy(buffer + params->n, node, params->n);
+        }
+        else {
+            memcpy(buffer, node, params->n);
+            memcpy(buffer + params->n, auth_path + i*params->n, params->n);
+        }
+        set_tree_height(addr, i);
+        set_tree_index(addr, leafidx >> (i + 1));
+        thash_h_ctx(params, ctx, node, buffer, addr);
+    }
+}
+
+unsigned int xmss_treehash_leaf(const xmss_params *params,
+                                xmss_thash_ctx *ctx,
+                                unsigned char *stack, unsigned int *heights,
+                                unsigned int *offset, unsigned char *wots_pk,
+                                unsigned char *auth_path,
+                                const unsigned char *sk_seed,
+                                uint32_t leaf_idx, uint32_t idx,
+                                const uint32_t subtree_addr[8])
+{
+    unsigned int merged = 0;
+    uint32_t tree_idx;
+
+    /* We need all three types of addresses in parallel. */
+    uint32_t ots_addr[8] = {0};
+    uint32_t ltree_addr[8] = {0};
+    uint32_t node_addr[8] = {0};
+
+    /* Select the required subtree. */
+    copy_subtree_addr(ots_addr, subtree_addr);
+    copy_subtree_addr(ltree_addr, subtree_addr);
+    copy_subtree_addr(node_addr, subtree_addr);
+
+    set_type(ots_addr, XMSS_ADDR_TYPE_OTS);
+    set_type(ltree_addr, XMSS_ADDR_TYPE_LTREE);
+    set_type(node_addr, XMSS_ADDR_TYPE_HASHTREE);
+
+    /* Add the next leaf node to the stack. */
+    set_ltree_addr(ltree_addr, idx);
+    set_ots_addr(ots_addr, idx);
+    wots_pkgen_ctx(params, ctx, wots_pk, sk_seed, ots_addr);
+    xmss_l_tree(params, ctx, stack + *offset*params->n, wots_pk, ltree_addr);
+    (*offset)++;
+    heights[*offset - 1] = 0;
+
+    /* If this is a node we need for the auth path.. */
+    if (auth_path != NULL && (leaf_idx ^ 0x1) == idx) {
+        memcpy(auth_path, stack + (*offset - 1)*params->n, params->n);
+    }
+
+    /* While the top-most nodes are of equal height.. */
+    while (*offset >= 2 && heights[*offset - 1] == heights[*offset - 2]) {
+        /* Compute index of the new node, in the next layer. */
+        tree_idx = (idx >> (heights[*offset - 1] + 1));
+
+        /* Hash the top-most nodes from the stack together. */
+        set_tree_height(node_addr, heights[*offset - 1]);
+        set_tree_index(node_addr, tree_idx);
+        thash_h_ctx(params, ctx, stack + (*offset - 2)*params->n,
+                    stack + (*offset - 2)*params->n, node_addr);
+        (*offset)--;
+        merged++;
+        /* Note that the top-most node is now one layer higher. */
+        heights[*offset - 1]++;
+
+        /* If this is a node we need for the auth path.. */
+        if (auth_path != NULL &&
+            ((leaf_idx >> heights[*offset - 1]) ^ 0x1) == tree_idx) {
+            memcpy(auth_path + heights[*offset - 1]*params->n,
+                   stack + (*offset - 1)*params->n, params->n);
+        }
+    }
+    return merged;
+}
+
+void xmss_treehash(const xmss_params *params, xmss_thash_ctx *ctx,
+                   unsigned char *root, unsigned char *auth_path,
+                   unsigned char *stack, unsigned int *heights,
+                   unsigned char *wots_pk, const unsigned char *sk_seed,
+                   uint32_t leaf_idx, const uint32_t subtree_addr[8])
+{
+    unsigned int offset = 0;
+    uint32_t idx;
+
+    for (idx = 0; idx < (uint32_t)1 << params->tree_height; idx++) {
+        xmss_treehash_leaf(params, ctx, stack, heights, &offset, wots_pk,
+                           auth_path, sk_seed, leaf_idx, idx, subtree_addr);
+    }
+    memcpy(root, stack, params->n);
+}
@@ -0,0 +1,62 @@
+#ifndef XMSS_TREE_H
+#define XMSS_TREE_H
+
+#include <stdint.h>
+#include "hash.h"
+#include "params.h"
+
+/*
+ * The hash tree computations that the signers and verifiers share. They all
+ * hash with ctx, which holds the pub_seed of the key.
+ */
+
+/**
+ * Computes a leaf node from a WOTS public key using an L-tree.
+ * Note that this destroys the used WOTS public key.
+ */
+void xmss_l_tree(const xmss_params *params, xmss_thash_ctx *ctx,
+                 unsigned char *leaf, unsigned char *wots_pk,
+                 uint32_t addr[8]);
+
+/**
+ * Climbs from 'node', the node at height 'from' on the path of leaf leafidx,
+ * to height 'to', and replaces node by the result. The node of the
+ * authentication path at height i is read from auth_path + i*n.
+ * addr has to contain the address of the subtree.
+ */
+void xmss_climb(const xmss_params *params, xmss_thash_ctx *ctx,
+                unsigned char *node, uint32_t leafidx,
+                const unsigned char *auth_path,
+                unsigned int from, unsigned int to, uint32_t addr[8]);
+
+/**
+ * Performs one iteration of Merkle's TreeHash on the subtree at
+ * subtree_addr: computes leaf idx, adds it to the stack of *offset nodes,
+ * and merges the top-most nodes while they are of equal height. If
+ * auth_path is not NULL, the nodes of the authentication path of leaf_idx
+ * are stored in it as they appear.
+ * stack holds tree_height + 1 nodes and heights as many entries; wots_pk is
+ * scratch space of wots_sig_bytes.
+ * Returns the number of nodes that were merged.
+ */
+unsigned int xmss_treehash_leaf(const xmss_params *params,
+                                xmss_thash_ctx *ctx,
+                                unsigned char *stack, unsigned int *heights,
+                                unsigned int *offset, unsigned char *wots_pk,
+                                unsigned char *auth_path,
+                                const unsigned char *sk_seed,
+                                uint32_t leaf_idx, uint32_t idx,
+                                const uint32_t subtree_addr[8]);
+
+/**
+ * For a given leaf index, computes the authentication path and the resulting
+ * root node of the subtree at subtree_addr, with the scratch space that
+ * xmss_treehash_leaf takes. auth_path may be NULL.
+ */
+void xmss_treehash(const xmss_params *params, xmss_thash_ctx *ctx,
+                   unsigned char *root, unsigned char *auth_path,
+                   unsigned char *stack, unsigned int *heights,
+                   unsigned char *wots_pk, const unsigned char *sk_seed,
+                   uint32_t leaf_idx, const uint32_t subtree_addr[8]);
+
+#endif
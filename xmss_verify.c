@@ -0,0 +1,421 @@
+#include <pthread.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "hash.h"
+#include "hash_address.h"
+#include "params.h"
+#include "wots.h"
+#include "utils.h"
+#include "xmss_trace.h"
+#include "xmss_tree.h"
+#include "xmss_verify.h"
+
+/* Checks whether a node of the top tree has been authenticated before. */
+static int node_known(const xmss_params *params, xmss_verify_cache *cache,
+                      unsigned long nodeidx, const unsigned char *node)
+{
+    int known;
+
+    pthread_mutex_lock(&cache->lock);
+    known = cache->valid[nodeidx] &&
+            !memcmp(cache->nodes + nodeidx*params->n, node, params->n);
+    pthread_mutex_unlock(&cache->lock);
+
+    return known;
+}
+
+/* Returns the slot of the subtree cache for a given subtree. */
+static unsigned int subtree_slot(const xmss_verify_cache *cache,
+                                 unsigned int layer, unsigned long long tree)
+{
+    return ((tree * 0x9E3779B97F4A7C15ULL) ^ layer) % cache->subtree_slots;
+}
+
+/* Checks whether the root of a subtree has been authenticated before. */
+static int subtree_known(const xmss_params *params,
+                         xmss_verify_cache *cache,
+                         unsigned int layer, unsigned long long tree,
+                         const unsigned char *root)
+{
+    unsigned int slot = subtree_slot(cache, layer, tree);
+    int known;
+
+    pthread_mutex_lock(&cache->lock);
+    known = cache->subtree_valid[slot] &&
+            cache->subtree_layers[slot] == layer &&
+            cache->subtree_trees[slot] == tree &&
+            !memcmp(cache->subtree_roots + slot*params->n, root, params->n);
+    pthread_mutex_unlock(&cache->lock);
+
+    return known;
+}
+
+static void subtree_insert(const xmss_params *params,
+                           xmss_verify_cache *cache,
+                           unsigned int layer, unsigned long long tree,
+                           const unsigned char *root)
+{
+    unsigned int slot = subtree_slot(cache, layer, tree);
+
+    cache->subtree_valid[slot] = 1;
+    cache->subtree_layers[slot] = layer;
+    cache->subtree_trees[slot] = tree;
+    memcpy(cache->subtree_roots + slot*params->n, root, params->n);
+}
+
+/**
+ * Stores the roots of the subtrees on the lowest 'layers' layers, which a
+ * valid signature has authenticated.
+ */
+static void subtrees_insert(const xmss_params *params,
+                            xmss_verify_cache *cache, unsigned int layers,
+                            const unsigned long long *trees,
+                            const unsigned char *roots)
+{
+    unsigned int i;
+
+    if (!cache->subtree_slots) {
+        return;
+    }
+    pthread_mutex_lock(&cache->lock);
+    for (i = 0; i < layers; i++) {
+        subtree_insert(params, cache, i, trees[i], roots + i*params->n);
+    }
+    pthread_mutex_unlock(&cache->lock);
+}
+
+/* Stores a node and its sibling, both authenticated by a valid signature. */
+static void cache_insert(const xmss_params *params, xmss_verify_cache *cache,
+                         unsigned long nodeidx, const unsigned char *node,
+                         const unsigned char *sibling)
+{
+    memcpy(cache->nodes + nodeidx*params->n, node, params->n);
+    memcpy(cache->nodes + (nodeidx ^ 1)*params->n, sibling, params->n);
+    cache->valid[nodeidx] = 1;
+    cache->valid[nodeidx ^ 1] = 1;
+}
+
+/**
+ * Verifies the signed message sm of length smlen under pk, as in
+ * xmssmt_core_sign_open, but without writing out the message.
+ * thash holds the pub_seed of pk. The cache may be NULL.
+ */
+static int verify_signed(const xmss_params *params, xmss_verify_cache *cache,
+                         xmss_thash_ctx *thash,
+                         const unsigned char *sm, unsigned long long smlen,
+                         const unsigned char *pk, xmss_trace *trace)
+{
+    const unsigned char *pub_root = pk;
+    unsigned char wots_pk[params->wots_sig_bytes];
+    unsigned char root[params->n];
+    unsigned char *mhash = root;
+    xmss_hash_msg_ctx hash;
+    unsigned char cache_node[params->n];
+    const unsigned char *cache_sibling = NULL;
+    unsigned long cache_idx = 0;
+    /* Roots of the lower subtrees, to be cached once they are verified. */
+    unsigned char subtree_roots[params->d * params->n];
+    unsigned long long subtree_trees[params->d];
+    unsigned long long mlen;
+    unsigned long long idx = 0;
+    unsigned int i;
+    uint32_t idx_leaf;
+
+    uint32_t ots_addr[8] = {0};
+    uint32_t ltree_addr[8] = {0};
+    uint32_t node_addr[8] = {0};
+
+    set_type(ots_addr, XMSS_ADDR_TYPE_OTS);
+    set_type(ltree_addr, XMSS_ADDR_TYPE_LTREE);
+    set_type(node_addr, XMSS_ADDR_TYPE_HASHTREE);
+
+    if (smlen < params->sig_bytes) {
+        return -1;
+    }
+    /* The cache only applies to the key it was first used with. */
+    if (cache != NULL) {
+        pthread_mutex_lock(&cache->lock);
+        if (!cache->used) {
+            memcpy(cache->pk, pk, params->pk_bytes);
+            cache->used = 1;
+        }
+        if (memcmp(cache->pk, pk, params->pk_bytes)) {
+            pthread_mutex_unlock(&cache->lock);
+            cache = NULL;
+        }
+        else {
+            pthread_mutex_unlock(&cache->lock);
+        }
+    }
+    mlen = smlen - params->sig_bytes;
+
+    /* Convert the index bytes from the signature to an integer. */
+    idx = bytes_to_ull(sm, params->index_bytes);
+
+    /* Compute the message hash, directly from where the message is. */
+    XMSS_TRACE_START(trace);
+    if (hash_message_init(params, &hash, sm + params->index_bytes, pub_root,
+                          idx)) {
+        return -1;
+    }
+    if (hash_message_update(params, &hash, sm + params->sig_bytes, mlen)) {
+        hash_message_final(params, &hash, mhash);
+        return -1;
+    }
+    if (hash_message_final(params, &hash, mhash)) {
+        return -1;
+    }
+    XMSS_TRACE_STOP(trace, XMSS_PHASE_VERIFY_MSG_HASH);
+    sm += params->index_bytes + params->n;
+
+    /* For each subtree.. */
+    for (i = 0; i < params->d; i++) {
+        idx_leaf = (idx & (((uint32_t)1 << params->tree_height) - 1));
+        idx = idx >> params->tree_height;
+
+        set_layer_addr(ots_addr, i);
+        set_layer_addr(ltree_addr, i);
+        set_layer_addr(node_addr, i);
+
+        set_tree_addr(ltree_addr, idx);
+        set_tree_addr(ots_addr, idx);
+        set_tree_addr(node_addr, idx);
+
+        /* The WOTS public key is only correct if the signature was correct. */
+        set_ots_addr(ots_addr, idx_leaf);
+        /* Initially, root = mhash, but on subsequent iterations it is the root
+           of the subtree below the currently processed subtree. */
+        XMSS_TRACE_START(trace);
+        wots_pk_from_sig_ctx(params, thash, wots_pk, sm, root, ots_addr);
+        XMSS_TRACE_STOP(trace, XMSS_PHASE_VERIFY_WOTS);
+        sm += params->wots_sig_bytes;
+
+        /* Compute the leaf node using the WOTS public key. */
+        set_ltree_addr(ltree_addr, idx_leaf);
+        XMSS_TRACE_START(trace);
+        xmss_l_tree(params, thash, root, wots_pk, ltree_addr);
+        XMSS_TRACE_STOP(trace, XMSS_PHASE_VERIFY_LTREE);
+
+        /* Compute the root node of this subtree. Nodes of the top tree may
+           already be known to lead to the public root. */
+        XMSS_TRACE_START(trace);
+        if (i == params->d - 1 && idx == 0 &&
+            cache != NULL && cache->nodes != NULL) {
+            xmss_climb(params, thash, root, idx_leaf, sm,
+                       0, cache->level, node_addr);
+            cache_idx = idx_leaf >> cache->level;
+            if (node_known(params, cache, cache_idx, root)) {
+                XMSS_TRACE_STOP(trace, XMSS_PHASE_VERIFY_ROOT);
+                subtrees_insert(params, cache, i, subtree_trees,
+                                subtree_roots);
+                return 0;
+            }
+            memcpy(cache_node, root, params->n);
+            cache_sibling = sm + cache->level*params->n;
+            xmss_climb(params, thash, root, idx_leaf, sm,
+                       cache->level, params->tree_height, node_addr);
+        }
+        else {
+            xmss_climb(params, thash, root, idx_leaf, sm,
+                       0, params->tree_height, node_addr);
+        }
+        sm += params->tree_height*params->n;
+        XMSS_TRACE_STOP(trace, XMSS_PHASE_VERIFY_ROOT);
+
+        /* If this subtree root has been verified up to the public root
+           before, the upper layers need not be verified again. */
+        if (i < params->d - 1 && cache != NULL && cache->subtree_slots) {
+            if (subtree_known(params, cache, i, idx, root)) {
+                subtrees_insert(params, cache, i, subtree_trees,
+                                subtree_roots);
+                return 0;
+            }
+            memcpy(subtree_roots + i*params->n, root, params->n);
+            subtree_trees[i] = idx;
+        }
+    }
+
+    /* Check if the root node equals the root node in the public key. */
+    if (memcmp(root, pub_root, params->n)) {
+        return -1;
+    }
+    if (cache == NULL) {
+        return 0;
+    }
+    if (cache_sibling != NULL) {
+        pthread_mutex_lock(&cache->lock);
+        cache_insert(params, cache, cache_idx, cache_node, cache_sibling);
+        pthread_mutex_unlock(&cache->lock);
+    }
+    subtrees_insert(params, cache, params->d - 1, subtree_trees,
+                    subtree_roots);
+    return 0;
+}
+
+int xmssmt_core_sign_open_batch(const xmss_params *params, int *results,
+                                const unsigned char **sms,
+                                const unsigned long long *smlens,
+                                unsigned int count, const unsigned char *pk)
+{
+    xmss_trace trace;
+    xmss_thash_ctx thash;
+    unsigned int i;
+    int ret = 0;
+
+    thash_ctx_init(params, &thash, pk + params->n);
+    for (i = 0; i < count; i++) {
+        memset(&trace, 0, sizeof(xmss_trace));
+        results[i] = verify_signed(params, NULL, &thash, sms[i], smlens[i], pk,
+                                   &trace);
+        XMSS_TRACE_EMIT(&trace);
+        ret |= results[i];
+    }
+    thash_ctx_release(&thash);
+
+    return ret;
+}
+
+int xmss_verify_cache_init(const xmss_params *params,
+                           xmss_verify_cache *cache, unsigned int k,
+                           unsigned int subtree_slots)
+{
+    memset(cache, 0, sizeof(xmss_verify_cache));
+    if (k > params->tree_height) {
+        return -1;
+    }
+    cache->pk = calloc(params->pk_bytes, 1);
+    if (cache->pk == NULL) {
+        return -1;
+    }
+    pthread_mutex_init(&cache->lock, NULL);
+    if (k > 0) {
+        cache->level = params->tree_height - k;
+        cache->nodes = malloc((1UL << k) * params->n);
+        cache->valid = calloc(1UL << k, 1);
+        if (cache->nodes == NULL || cache->valid == NULL) {
+            xmss_verify_cache_free(cache);
+            return -1;
+        }
+    }
+    if (subtree_slots > 0 && params->d > 1) {
+        cache->subtree_slots = subtree_slots;
+        cache->subtree_valid = calloc(subtree_slots, 1);
+        cache->subtree_layers = calloc(subtree_slots, sizeof(unsigned int));
+        cache->subtree_trees = calloc(subtree_slots,
+                                      sizeof(unsigned long long));
+        cache->subtree_roots = calloc(subtree_slots, params->n);
+        if (cache->subtree_valid == NULL || cache->subtree_layers == NULL ||
+            cache->subtree_trees == NULL || cache->subtree_roots == NULL) {
+            xmss_verify_cache_free(cache);
+            return -1;
+        }
+    }
+    return 0;
+}
+
+void xmss_verify_cache_free(xmss_verify_cache *cache)
+{
+    pthread_mutex_destroy(&cache->lock);
+    free(cache->nodes);
+    free(cache->valid);
+    free(cache->subtree_valid);
+    free(cache->subtree_layers);
+    free(cache->subtree_trees);
+    free(cache->subtree_roots);
+    free(cache->pk);
+    memset(cache, 0, sizeof(xmss_verify_cache));
+}
+
+int xmssmt_core_sign_open_cached(const xmss_params *params,
+                                 xmss_verify_cache *cache,
+                                 const unsigned char *sm,
+                                 unsigned long long smlen,
+                                 const unsigned char *pk)
+{
+    xmss_trace trace;
+    xmss_thash_ctx thash;
+    int ret;
+
+    memset(&trace, 0, sizeof(xmss_trace));
+    thash_ctx_init(params, &thash, pk + params->n);
+    ret = verify_signed(params, cache, &thash, sm, smlen, pk, &trace);
+    thash_ctx_release(&thash);
+    XMSS_TRACE_EMIT(&trace);
+    return ret;
+}
+
+int xmssmt_core_sign_open_cached_ctx(const xmss_params *params,
+                                     xmss_verify_cache *cache,
+                                     const xmss_thash_ctx *thash,
+                                     const unsigned char *sm,
+                                     unsigned long long smlen,
+                                     const unsigned char *pk)
+{
+    xmss_trace trace;
+    xmss_thash_ctx work;
+    int ret;
+
+    memset(&trace, 0, sizeof(xmss_trace));
+    thash_ctx_share(params, &work, thash);
+    ret = verify_signed(params, cache, &work, sm, smlen, pk, &trace);
+    thash_ctx_release(&work);
+    XMSS_TRACE_EMIT(&trace);
+    return ret;
+}
+
+int xmss_core_sign_open_cached(const xmss_params *params,
+                               xmss_verify_cache *cache,
+                               const unsigned char *sm,
+                               unsigned long long smlen,
+                               const unsigned char *pk)
+{
+    return xmssmt_core_sign_open_cached(params, cache, sm, smlen, pk);
+}
+
+int xmss_core_sign_open_batch(const xmss_params *params, int *results,
+                              const unsigned char **sms,
+                              const unsigned long long *smlens,
+                              unsigned int count, const unsigned char *pk)
+{
+    return xmssmt_core_sign_open_batch(params, results, sms, smlens, count, pk);
+}
+
+int xmss_sign_open_batch(int *results,
+                         const unsigned char **sms,
+                         const unsigned long long *smlens,
+                         unsigned int count, const unsigned char *pk)
+{
+    xmss_params params;
+    uint32_t oid = (uint32_t)bytes_to_ull(pk, XMSS_OID_LEN);
+    unsigned int i;
+
+    if (xmss_parse_oid(&params, oid)) {
+        for (i = 0; i < count; i++) {
+            results[i] = -1;
+        }
+        return -1;
+    }
+    return xmss_core_sign_open_batch(&params, results, sms, smlens, count,
+                                     pk + XMSS_OID_LEN);
+}
+
+int xmssmt_sign_open_batch(int *results,
+                           const unsigned char **sms,
+                           const unsigned long long *smlens,
+                           unsigned int count, const unsigned char *pk)
+{
+    xmss_params params;
+    uint32_t oid = (uint32_t)bytes_to_ull(pk, XMSS_OID_LEN);
+    unsigned int i;
+
+    if (xmssmt_parse_oid(&params, oid)) {
+        for (i = 0; i < count; i++) {
+            results[i] = -1;
+        }
+        return -1;
+    }
+    return xmssmt_core_sign_open_batch(&params, results, sms, smlens, count,
+                                       pk + XMSS_OID_LEN);
+}
@@ -0,0 +1,123 @@
+#ifndef XMSS_VERIFY_H
+#define XMSS_VERIFY_H
+
+#include <pthread.h>
+#include "hash.h"
+#include "params.h"
+
+/**
+ * Verifier-side caches for one public key.
+ *
+ * The node cache holds nodes of the top tree, i.e. of the single tree of
+ * XMSS or of the top layer tree of XMSS^MT. Once a signature has been
+ * verified, the node on its path k levels below the root (and that node's
+ * sibling) are known to lead to the root. Later verifications stop climbing
+ * as soon as they reach such a node, saving up to k thash_h calls each.
+ * It takes 2^k * n bytes for the nodes.
+ *
+ * For XMSS^MT, the subtree cache remembers (layer, tree index, subtree root)
+ * for the lower layers of verified signatures. All signatures from the same
+ * bottom subtree share the upper layers, so once a later signature yields a
+ * known subtree root, its remaining (d-1) layers are skipped. It is a
+ * direct-mapped table of 'subtree_slots' entries. Note that the skipped
+ * layers are then not parsed at all: a signature with altered upper layers
+ * is accepted, as the message is already authenticated by the cached root.
+ *
+ * A cache is bound to the first public key it is used with, and is ignored
+ * for any other key. It may be shared by concurrent verifications; its lock
+ * is only held while looking up or inserting entries.
+ */
+typedef struct {
+    unsigned int level;
+    unsigned char *nodes;
+    unsigned char *valid;
+    unsigned int subtree_slots;
+    unsigned char *subtree_valid;
+    unsigned int *subtree_layers;
+    unsigned long long *subtree_trees;
+    unsigned char *subtree_roots;
+    unsigned char *pk;
+    int used;
+    pthread_mutex_t lock;
+} xmss_verify_cache;
+
+/**
+ * Allocates an empty cache for the nodes k levels below the root, for
+ * k <= params->tree_height, and with room for 'subtree_slots' subtree roots.
+ * Either part is disabled by passing 0. Returns -1 on failure.
+ */
+int xmss_verify_cache_init(const xmss_params *params,
+                           xmss_verify_cache *cache, unsigned int k,
+                           unsigned int subtree_slots);
+
+/* Frees the memory held by the cache. */
+void xmss_verify_cache_free(xmss_verify_cache *cache);
+
+/**
+ * Verifies the signed message sm of length smlen under pk (without OID),
+ * using and updating the cache. The message is not copied out; for a valid
+ * signature it starts at sm + params->sig_bytes.
+ * Without a subtree cache, returns 0 if the signature is valid, -1
+ * otherwise. With a subtree cache, 0 only means that the message is
+ * authenticated under pk: when a cached subtree root is reached, the upper
+ * layers of sm are not read, so a signature whose upper layers were altered
+ * is accepted, although it is not a valid signature in the sense of RFC 8391.
+ */
+int xmssmt_core_sign_open_cached(const xmss_params *params,
+                                 xmss_verify_cache *cache,
+                                 const unsigned char *sm,
+                                 unsigned long long smlen,
+                                 const unsigned char *pk);
+
+/**
+ * As xmssmt_core_sign_open_cached, with the hash state thash that
+ * thash_ctx_init has set up for the pub_seed of pk. thash is only read, so
+ * that it can be seeded once per key and shared by concurrent calls.
+ */
+int xmssmt_core_sign_open_cached_ctx(const xmss_params *params,
+                                     xmss_verify_cache *cache,
+                                     const xmss_thash_ctx *thash,
+                                     const unsigned char *sm,
+                                     unsigned long long smlen,
+                                     const unsigned char *pk);
+
+/* The XMSS variant; XMSS is XMSS^MT with d = 1. */
+int xmss_core_sign_open_cached(const xmss_params *params,
+                               xmss_verify_cache *cache,
+                               const unsigned char *sm,
+                               unsigned long long smlen,
+                               const unsigned char *pk);
+
+/**
+ * Verifies 'count' signed messages sms[i] of length smlens[i], all under the
+ * same public key pk (without OID). Sets results[i] to 0 if sms[i] is valid
+ * and to -1 otherwise; the message of a valid sms[i] starts at
+ * sms[i] + params->sig_bytes, as it is not copied out.
+ * Returns 0 if all signatures are valid, -1 otherwise.
+ */
+int xmssmt_core_sign_open_batch(const xmss_params *params, int *results,
+                                const unsigned char **sms,
+                                const unsigned long long *smlens,
+                                unsigned int count, const unsigned char *pk);
+
+/* The XMSS variant; XMSS is XMSS^MT with d = 1. */
+int xmss_core_sign_open_batch(const xmss_params *params, int *results,
+                              const unsigned char **sms,
+                              const unsigned long long *smlens,
+                              unsigned int count, const unsigned char *pk);
+
+/**
+ * As above, but for a public key that starts with its OID. The OID is only
+ * parsed once for the whole batch.
+ */
+int xmss_sign_open_batch(int *results,
+                         const unsigned char **sms,
+                         const unsigned long long *smlens,
+                         unsigned int count, const unsigned char *pk);
+
+int xmssmt_sign_open_batch(int *results,
+                           const unsigned char **sms,
+                           const unsigned long long *smlens,
+                           unsigned int count, const unsigned char *pk);
+
+#endif
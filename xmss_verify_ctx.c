@@ -0,0 +1,270 @@
+#include <pthread.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "hash.h"
+#include "params.h"
+#include "utils.h"
+#include "xmss_verify.h"
+#include "xmss_verify_ctx.h"
+
+struct xmss_verify_ctx_cache {
+    unsigned int capacity;
+    unsigned int count;
+    unsigned int k;
+    unsigned int subtree_slots;
+    /* Hash table with chaining; the number of buckets is a power of two. */
+    xmss_verify_ctx **buckets;
+    unsigned long mask;
+    /* Most recently used context first. */
+    xmss_verify_ctx *lru_head;
+    xmss_verify_ctx *lru_tail;
+    pthread_mutex_t lock;
+};
+
+/* FNV-1a over the key bytes and the XMSS / XMSS^MT selector. */
+static unsigned long hash_key(const unsigned char *pk, unsigned long long pklen,
+                              int mt)
+{
+    unsigned long long h = 0xcbf29ce484222325ULL;
+    unsigned long long i;
+
+    for (i = 0; i < pklen; i++) {
+        h = (h ^ pk[i]) * 0x100000001b3ULL;
+    }
+    return (unsigned long)((h ^ (unsigned long long)mt) * 0x100000001b3ULL);
+}
+
+static void lru_unlink(xmss_verify_ctx_cache *cache, xmss_verify_ctx *ctx)
+{
+    if (ctx->lru_prev != NULL) {
+        ctx->lru_prev->lru_next = ctx->lru_next;
+    }
+    else {
+        cache->lru_head = ctx->lru_next;
+    }
+    if (ctx->lru_next != NULL) {
+        ctx->lru_next->lru_prev = ctx->lru_prev;
+    }
+    else {
+        cache->lru_tail = ctx->lru_prev;
+    }
+    ctx->lru_prev = ctx->lru_next = NULL;
+}
+
+static void lru_push(xmss_verify_ctx_cache *cache, xmss_verify_ctx *ctx)
+{
+    ctx->lru_prev = NULL;
+    ctx->lru_next = cache->lru_head;
+    if (cache->lru_head != NULL) {
+        cache->lru_head->lru_prev = ctx;
+    }
+    else {
+        cache->lru_tail = ctx;
+    }
+    cache->lru_head = ctx;
+}
+
+static void ctx_free(xmss_verify_ctx *ctx)
+{
+    xmss_verify_cache_free(&ctx->cache);
+    thash_ctx_release(&ctx->thash);
+    free(ctx->pk);
+    free(ctx);
+}
+
+/* Creates a context; this is all per-key work that is done only once. */
+static xmss_verify_ctx *ctx_create(const xmss_verify_ctx_cache *cache,
+                                   const unsigned char *pk,
+                                   unsigned long long pklen, int mt)
+{
+    xmss_verify_ctx *ctx;
+    uint32_t oid;
+    int ret;
+
+    if (pklen < XMSS_OID_LEN) {
+        return NULL;
+    }
+    ctx = calloc(1, sizeof(xmss_verify_ctx));
+    if (ctx == NULL) {
+        return NULL;
+    }
+    oid = (uint32_t)bytes_to_ull(pk, XMSS_OID_LEN);
+    ret = mt ? xmssmt_parse_oid(&ctx->params, oid)
+             : xmss_parse_oid(&ctx->params, oid);
+    if (ret || pklen != XMSS_OID_LEN + ctx->params.pk_bytes) {
+        free(ctx);
+        return NULL;
+    }
+    ctx->mt = mt;
+    ctx->pklen = pklen;
+    ctx->pk = malloc(pklen);
+    if (ctx->pk == NULL) {
+        free(ctx);
+        return NULL;
+    }
+    memcpy(ctx->pk, pk, pklen);
+    if (xmss_verify_cache_init(&ctx->params, &ctx->cache,
+                               cache->k > ctx->params.tree_height
+                                   ? ctx->params.tree_height : cache->k,
+                               cache->subtree_slots)) {
+        free(ctx->pk);
+        free(ctx);
+        return NULL;
+    }
+    thash_ctx_init(&ctx->params, &ctx->thash,
+                   ctx->pk + XMSS_OID_LEN + ctx->params.n);
+    return ctx;
+}
+
+xmss_verify_ctx_cache *xmss_verify_ctx_cache_create(unsigned int capacity,
+                                                    unsigned int k,
+                                                    unsigned int subtree_slots)
+{
+    xmss_verify_ctx_cache *cache;
+    unsigned long buckets = 1;
+
+    if (capacity == 0) {
+        return NULL;
+    }
+    while (buckets < 2UL * capacity) {
+        buckets <<= 1;
+    }
+    cache = calloc(1, sizeof(xmss_verify_ctx_cache));
+    if (cache == NULL) {
+        return NULL;
+    }
+    cache->buckets = calloc(buckets, sizeof(xmss_verify_ctx *));
+    if (cache->buckets == NULL) {
+        free(cache);
+        return NULL;
+    }
+    cache->capacity = capacity;
+    cache->mask = buckets - 1;
+    cache->k = k;
+    cache->subtree_slots = subtree_slots;
+    pthread_mutex_init(&cache->lock, NULL);
+
+    return cache;
+}
+
+void xmss_verify_ctx_cache_destroy(xmss_verify_ctx_cache *cache)
+{
+    xmss_verify_ctx *ctx;
+
+    while ((ctx = cache->lru_head) != NULL) {
+        lru_unlink(cache, ctx);
+        ctx_free(ctx);
+    }
+    pthread_mutex_destroy(&cache->lock);
+    free(cache->buckets);
+    free(cache);
+}
+
+/* Removes the least recently used context that is not in use. */
+static void evict(xmss_verify_ctx_cache *cache)
+{
+    xmss_verify_ctx *ctx = cache->lru_tail;
+    xmss_verify_ctx **p;
+
+    while (ctx != NULL && ctx->refs > 0) {
+        ctx = ctx->lru_prev;
+    }
+    if (ctx == NULL) {
+        return;
+    }
+    for (p = &cache->buckets[ctx->hash & cache->mask]; *p != ctx;
+         p = &(*p)->next);
+    *p = ctx->next;
+    lru_unlink(cache, ctx);
+    cache->count--;
+    ctx_free(ctx);
+}
+
+xmss_verify_ctx *xmss_verify_ctx_cache_get(xmss_verify_ctx_cache *cache,
+                                           const unsigned char *pk,
+                                           unsigned long long pklen, int mt)
+{
+    unsigned long hash = hash_key(pk, pklen, mt);
+    xmss_verify_ctx *ctx;
+    xmss_verify_ctx *created;
+
+    pthread_mutex_lock(&cache->lock);
+    for (ctx = cache->buckets[hash & cache->mask]; ctx != NULL;
+         ctx = ctx->next) {
+        if (ctx->hash == hash && ctx->mt == mt && ctx->pklen == pklen &&
+            !memcmp(ctx->pk, pk, pklen)) {
+            ctx->refs++;
+            lru_unlink(cache, ctx);
+            lru_push(cache, ctx);
+            pthread_mutex_unlock(&cache->lock);
+            return ctx;
+        }
+    }
+    pthread_mutex_unlock(&cache->lock);
+
+    /* Parse outside of the lock; another thread may race us to it. */
+    created = ctx_create(cache, pk, pklen, mt);
+    if (created == NULL) {
+        return NULL;
+    }
+    created->hash = hash;
+
+    pthread_mutex_lock(&cache->lock);
+    for (ctx = cache->buckets[hash & cache->mask]; ctx != NULL;
+         ctx = ctx->next) {
+        if (ctx->hash == hash && ctx->mt == mt && ctx->pklen == pklen &&
+            !memcmp(ctx->pk, pk, pklen)) {
+            break;
+        }
+    }
+    if (ctx == NULL) {
+        if (cache->count >= cache->capacity) {
+            evict(cache);
+        }
+        ctx = created;
+        created = NULL;
+        ctx->next = cache->buckets[hash & cache->mask];
+        cache->buckets[hash & cache->mask] = ctx;
+        lru_push(cache, ctx);
+        cache->count++;
+    }
+    else {
+        lru_unlink(cache, ctx);
+        lru_push(cache, ctx);
+    }
+    ctx->refs++;
+    pthread_mutex_unlock(&cache->lock);
+
+    if (created != NULL) {
+        ctx_free(created);
+    }
+    return ctx;
+}
+
+void xmss_verify_ctx_release(xmss_verify_ctx_cache *cache,
+                             xmss_verify_ctx *ctx)
+{
+    pthread_mutex_lock(&cache->lock);
+    ctx->refs--;
+    /* Contexts that were in use during eviction are removed now. */
+    while (cache->count > cache->capacity) {
+        unsigned int count = cache->count;
+
+        evict(cache);
+        if (cache->count == count) {
+            break;
+        }
+    }
+    pthread_mutex_unlock(&cache->lock);
+}
+
+int xmss_verify_ctx_sign_open(xmss_verify_ctx *ctx,
+                              const unsigned char *sm,
+                              unsigned long long smlen)
+{
+    return xmssmt_core_sign_open_cached_ctx(&ctx->params, &ctx->cache,
+                                            &ctx->thash, sm, smlen,
+                                            ctx->pk + XMSS_OID_LEN);
+}
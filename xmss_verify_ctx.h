@@ -0,0 +1,80 @@
+#ifndef XMSS_VERIFY_CTX_H
+#define XMSS_VERIFY_CTX_H
+
+#include <stdint.h>
+#include "hash.h"
+#include "params.h"
+#include "xmss_verify.h"
+
+/**
+ * Everything a verifier derives from a public key: the parsed parameters,
+ * the key itself, the hash state seeded with its pub_seed and the caches of
+ * xmss_verify_cache. Contexts are created and handed out by an
+ * xmss_verify_ctx_cache.
+ */
+typedef struct xmss_verify_ctx {
+    xmss_params params;
+    int mt;
+    unsigned char *pk;
+    unsigned long long pklen;
+    xmss_thash_ctx thash;
+    xmss_verify_cache cache;
+    /* Bookkeeping of the xmss_verify_ctx_cache. */
+    unsigned long hash;
+    unsigned int refs;
+    struct xmss_verify_ctx *next;
+    struct xmss_verify_ctx *lru_prev;
+    struct xmss_verify_ctx *lru_next;
+} xmss_verify_ctx;
+
+/**
+ * A bounded cache of verifier contexts, keyed by the public key bytes
+ * (including the OID). When full, the least recently used context is
+ * evicted. All functions may be called concurrently.
+ */
+typedef struct xmss_verify_ctx_cache xmss_verify_ctx_cache;
+
+/**
+ * Creates a cache for up to 'capacity' contexts. Each context gets a
+ * verifier cache with parameters k and subtree_slots, as in
+ * xmss_verify_cache_init. Returns NULL on failure.
+ */
+xmss_verify_ctx_cache *xmss_verify_ctx_cache_create(unsigned int capacity,
+                                                    unsigned int k,
+                                                    unsigned int subtree_slots);
+
+/**
+ * Frees the cache. All contexts must have been released.
+ */
+void xmss_verify_ctx_cache_destroy(xmss_verify_ctx_cache *cache);
+
+/**
+ * Returns the context for the public key pk of pklen bytes, which starts
+ * with its OID; mt selects between XMSS and XMSS^MT OIDs. The context is
+ * created if it is not cached yet. Returns NULL if the OID cannot be parsed,
+ * the length does not match it, or memory runs out.
+ * Each returned context must be handed back with xmss_verify_ctx_release.
+ */
+xmss_verify_ctx *xmss_verify_ctx_cache_get(xmss_verify_ctx_cache *cache,
+                                           const unsigned char *pk,
+                                           unsigned long long pklen, int mt);
+
+/**
+ * Releases a context obtained from xmss_verify_ctx_cache_get.
+ */
+void xmss_verify_ctx_release(xmss_verify_ctx_cache *cache,
+                             xmss_verify_ctx *ctx);
+
+/**
+ * Verifies the signed message sm of length smlen under the key of ctx.
+ * The message is not copied out; for a valid signature it starts at
+ * sm + ctx->params.sig_bytes.
+ * Returns 0 if the message is authenticated, -1 otherwise; with subtree
+ * slots, as for xmssmt_core_sign_open_cached, altered upper layers may go
+ * unnoticed.
+ */
+int xmss_verify_ctx_sign_open(xmss_verify_ctx *ctx,
+                              const unsigned char *sm,
+                              unsigned long long smlen);
+
+#endif
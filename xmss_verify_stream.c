@@ -0,0 +1,322 @@
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "hash.h"
+#include "hash_address.h"
+#include "params.h"
+#include "utils.h"
+#include "wots.h"
+#include "xmss_tree.h"
+#include "xmss_verify_stream.h"
+
+/* Returns the offset of the signature of a layer within the signature. */
+static unsigned long long layer_offset(const xmss_params *params,
+                                       unsigned int layer)
+{
+    return params->index_bytes + params->n +
+           layer * (params->wots_sig_bytes + params->tree_height*params->n);
+}
+
+/* Returns the number of n-byte elements from 'offset' that are present. */
+static unsigned long long available(const xmss_verify_stream *state,
+                                    unsigned long long offset)
+{
+    if (state->received <= offset) {
+        return 0;
+    }
+    return (state->received - offset) / state->params->n;
+}
+
+/* Sets up the addresses for the subtree of the current layer. */
+static void layer_begin(xmss_verify_stream *state)
+{
+    const xmss_params *params = state->params;
+    unsigned int h;
+
+    state->idx_leaf = (state->idx & (((uint32_t)1 << params->tree_height) - 1));
+    state->idx = state->idx >> params->tree_height;
+    state->chains = 0;
+    state->auth = 0;
+    for (h = 0; h < state->ltree_levels; h++) {
+        state->ltree_done[h] = 0;
+    }
+
+    set_layer_addr(state->ots_addr, state->layer);
+    set_layer_addr(state->ltree_addr, state->layer);
+    set_layer_addr(state->node_addr, state->layer);
+
+    set_tree_addr(state->ots_addr, state->idx);
+    set_tree_addr(state->ltree_addr, state->idx);
+    set_tree_addr(state->node_addr, state->idx);
+
+    set_ots_addr(state->ots_addr, state->idx_leaf);
+    set_ltree_addr(state->ltree_addr, state->idx_leaf);
+}
+
+/**
+ * Computes all L-tree nodes whose children are known. This yields the same
+ * nodes as l_tree: a node without a right sibling is pulled up unchanged.
+ */
+static void ltree_climb(xmss_verify_stream *state)
+{
+    const xmss_params *params = state->params;
+    unsigned char *level;
+    unsigned char *parent;
+    unsigned int h;
+    unsigned int j;
+    unsigned int need;
+
+    for (h = 0; h + 1 < state->ltree_levels; h++) {
+        level = state->ltree + state->ltree_offset[h]*params->n;
+        parent = state->ltree + state->ltree_offset[h + 1]*params->n;
+        while (state->ltree_done[h + 1] < state->ltree_size[h + 1]) {
+            j = state->ltree_done[h + 1];
+            need = 2*j + 2 < state->ltree_size[h]
+                   ? 2*j + 2 : state->ltree_size[h];
+            if (state->ltree_done[h] < need) {
+                break;
+            }
+            if (2*j + 1 < state->ltree_size[h]) {
+                set_tree_height(state->ltree_addr, h);
+                set_tree_index(state->ltree_addr, j);
+                thash_h_ctx(params, &state->thash, parent + j*params->n,
+                            level + 2*j*params->n, state->ltree_addr);
+            }
+            else {
+                memcpy(parent + j*params->n, level + 2*j*params->n,
+                       params->n);
+            }
+            state->ltree_done[h + 1]++;
+        }
+    }
+}
+
+/* Processes everything that the received signature bytes allow. */
+static void advance(xmss_verify_stream *state)
+{
+    const xmss_params *params = state->params;
+    const unsigned char *sig;
+    unsigned long long avail;
+    unsigned int top = state->ltree_levels - 1;
+
+    if (state->hashing != 2 || state->failed) {
+        return;
+    }
+
+    while (state->layer < params->d) {
+        sig = state->sig + layer_offset(params, state->layer);
+
+        /* The WOTS public key, one chain at a time, and its L-tree. */
+        if (state->chains < params->wots_len) {
+            avail = available(state, layer_offset(params, state->layer));
+            if (avail > params->wots_len) {
+                avail = params->wots_len;
+            }
+            if (avail > state->chains) {
+                wots_pk_from_sig_chains_ctx(params, &state->thash,
+                                            state->ltree, sig, state->root,
+                                            state->chains, avail,
+                                            state->ots_addr);
+                state->chains = avail;
+                state->ltree_done[0] = avail;
+                ltree_climb(state);
+            }
+            if (state->chains < params->wots_len) {
+                return;
+            }
+            memcpy(state->node,
+                   state->ltree + state->ltree_offset[top]*params->n,
+                   params->n);
+        }
+
+        /* The climb to the root of the subtree, one level at a time. */
+        avail = available(state, layer_offset(params, state->layer) +
+                                 params->wots_sig_bytes);
+        if (avail > params->tree_height) {
+            avail = params->tree_height;
+        }
+        if (avail > state->auth) {
+            xmss_climb(params, &state->thash, state->node, state->idx_leaf,
+                       sig + params->wots_sig_bytes, state->auth, avail,
+                       state->node_addr);
+            state->auth = avail;
+        }
+        if (state->auth < params->tree_height) {
+            return;
+        }
+
+        /* The root of this subtree is the message of the next layer. */
+        memcpy(state->root, state->node, params->n);
+        state->layer++;
+        if (state->layer < params->d) {
+            layer_begin(state);
+        }
+    }
+}
+
+/* Starts the message hash, once R and the index have been received. */
+static int start_hash(xmss_verify_stream *state)
+{
+    const xmss_params *params = state->params;
+
+    if (state->hashing) {
+        return 0;
+    }
+    if (state->received < params->index_bytes + params->n) {
+        return -1;
+    }
+    state->idx = bytes_to_ull(state->sig, params->index_bytes);
+    if (hash_message_init(params, &state->hash, state->sig + params->index_bytes,
+                          state->pub_root, state->idx)) {
+        return -1;
+    }
+    state->hashing = 1;
+    return 0;
+}
+
+int xmssmt_core_verify_begin(const xmss_params *params,
+                             xmss_verify_stream *state,
+                             const unsigned char *pk)
+{
+    unsigned int h;
+    unsigned int total = 0;
+
+    if (params->n > XMSS_STREAM_MAX_N) {
+        return -1;
+    }
+
+    memset(state, 0, sizeof(xmss_verify_stream));
+    state->params = params;
+    memcpy(state->pub_root, pk, params->n);
+    thash_ctx_init(params, &state->thash, pk + params->n);
+
+    /* The level sizes of the L-tree, from the WOTS public key upwards. */
+    state->ltree_size[0] = params->wots_len;
+    for (h = 0; state->ltree_size[h] > 1; h++) {
+        if (h + 1 >= XMSS_STREAM_MAX_LTREE_LEVELS) {
+            return -1;
+        }
+        state->ltree_size[h + 1] = (state->ltree_size[h] + 1) / 2;
+    }
+    state->ltree_levels = h + 1;
+    for (h = 0; h < state->ltree_levels; h++) {
+        state->ltree_offset[h] = total;
+        total += state->ltree_size[h];
+    }
+
+    state->sig = malloc(params->sig_bytes);
+    state->ltree = malloc((unsigned long long)total * params->n);
+    if (state->sig == NULL || state->ltree == NULL) {
+        free(state->sig);
+        free(state->ltree);
+        return -1;
+    }
+
+    set_type(state->ots_addr, XMSS_ADDR_TYPE_OTS);
+    set_type(state->ltree_addr, XMSS_ADDR_TYPE_LTREE);
+    set_type(state->node_addr, XMSS_ADDR_TYPE_HASHTREE);
+
+    return 0;
+}
+
+int xmssmt_core_verify_sig_update(xmss_verify_stream *state,
+                                  const unsigned char *sig,
+                                  unsigned long long siglen)
+{
+    if (siglen > state->params->sig_bytes - state->received) {
+        state->failed = 1;
+        return -1;
+    }
+    memcpy(state->sig + state->received, sig, siglen);
+    state->received += siglen;
+    advance(state);
+
+    return 0;
+}
+
+int xmssmt_core_verify_msg_update(xmss_verify_stream *state,
+                                  const unsigned char *m,
+                                  unsigned long long mlen)
+{
+    if (state->hashing == 2 || start_hash(state)) {
+        state->failed = 1;
+        return -1;
+    }
+    if (hash_message_update(state->params, &state->hash, m, mlen)) {
+        state->failed = 1;
+        return -1;
+    }
+    return 0;
+}
+
+int xmssmt_core_verify_msg_final(xmss_verify_stream *state)
+{
+    if (state->hashing == 2) {
+        return 0;
+    }
+    if (start_hash(state)) {
+        state->failed = 1;
+        return -1;
+    }
+    state->hashing = 2;
+    if (hash_message_final(state->params, &state->hash, state->root)) {
+        state->failed = 1;
+        return -1;
+    }
+    layer_begin(state);
+    advance(state);
+
+    return 0;
+}
+
+int xmssmt_core_verify_finish(xmss_verify_stream *state)
+{
+    int ret = -1;
+
+    if (state->hashing != 2) {
+        xmssmt_core_verify_msg_final(state);
+    }
+    if (!state->failed && state->layer == state->params->d &&
+        !memcmp(state->root, state->pub_root, state->params->n)) {
+        ret = 0;
+    }
+
+    free(state->sig);
+    free(state->ltree);
+    thash_ctx_release(&state->thash);
+    memset(state, 0, sizeof(xmss_verify_stream));
+
+    return ret;
+}
+
+int xmss_core_verify_begin(const xmss_params *params,
+                           xmss_verify_stream *state,
+                           const unsigned char *pk)
+{
+    return xmssmt_core_verify_begin(params, state, pk);
+}
+
+int xmss_core_verify_sig_update(xmss_verify_stream *state,
+                                const unsigned char *sig,
+                                unsigned long long siglen)
+{
+    return xmssmt_core_verify_sig_update(state, sig, siglen);
+}
+
+int xmss_core_verify_msg_update(xmss_verify_stream *state,
+                                const unsigned char *m,
+                                unsigned long long mlen)
+{
+    return xmssmt_core_verify_msg_update(state, m, mlen);
+}
+
+int xmss_core_verify_msg_final(xmss_verify_stream *state)
+{
+    return xmssmt_core_verify_msg_final(state);
+}
+
+int xmss_core_verify_finish(xmss_verify_stream *state)
+{
+    return xmssmt_core_verify_finish(state);
+}
@@ -0,0 +1,118 @@
+#ifndef XMSS_VERIFY_STREAM_H
+#define XMSS_VERIFY_STREAM_H
+
+#include <stdint.h>
+#include "hash.h"
+#include "params.h"
+
+/* Upper bounds for the state kept in between updates. */
+#define XMSS_STREAM_MAX_N 64
+#define XMSS_STREAM_MAX_LTREE_LEVELS 16
+
+/**
+ * State of a signature verification that consumes the signature and the
+ * message as they arrive. The fields are internal; the struct is only
+ * exposed so that callers can allocate it.
+ *
+ * Every section of the signature is processed as soon as its bytes are
+ * present: each WOTS chain as soon as its n bytes are, the L-tree nodes as
+ * soon as their children are, and each step of the climb to the subtree
+ * root as soon as its authentication path node is. As each layer signs the
+ * result of the layer below it, and the bottom layer signs the message
+ * hash, this can only start once the message is complete. Signature bytes
+ * received before that are kept until then.
+ */
+typedef struct {
+    const xmss_params *params;
+    unsigned char pub_root[XMSS_STREAM_MAX_N];
+    /* The hash state under the pub_seed of the key. */
+    xmss_thash_ctx thash;
+    unsigned char *sig;
+    unsigned long long received;
+    xmss_hash_msg_ctx hash;
+    /* 0 before the message hash starts, 1 while hashing, 2 once done. */
+    int hashing;
+    int failed;
+    unsigned long long idx;
+    uint32_t idx_leaf;
+    unsigned int layer;
+    unsigned int chains;
+    unsigned int auth;
+    uint32_t ots_addr[8];
+    uint32_t ltree_addr[8];
+    uint32_t node_addr[8];
+    /* The message signed by the current layer, and the node of its climb. */
+    unsigned char root[XMSS_STREAM_MAX_N];
+    unsigned char node[XMSS_STREAM_MAX_N];
+    /* L-tree of the current layer, stored level by level. */
+    unsigned char *ltree;
+    unsigned int ltree_levels;
+    unsigned int ltree_size[XMSS_STREAM_MAX_LTREE_LEVELS];
+    unsigned int ltree_done[XMSS_STREAM_MAX_LTREE_LEVELS];
+    unsigned int ltree_offset[XMSS_STREAM_MAX_LTREE_LEVELS];
+} xmss_verify_stream;
+
+/**
+ * Starts verifying a signature under pk (without OID). The signature is
+ * passed to xmssmt_core_verify_sig_update and the message to
+ * xmssmt_core_verify_msg_update, each in any number of parts. The message
+ * hash depends on the first index_bytes + n bytes of the signature, so the
+ * message can only be passed after those.
+ * Returns -1 on failure; otherwise, xmssmt_core_verify_finish has to be
+ * called to release the state.
+ */
+int xmssmt_core_verify_begin(const xmss_params *params,
+                             xmss_verify_stream *state,
+                             const unsigned char *pk);
+
+/**
+ * Passes the next siglen bytes of the signature, and processes everything
+ * that they complete. Returns -1 if the signature is too long.
+ */
+int xmssmt_core_verify_sig_update(xmss_verify_stream *state,
+                                  const unsigned char *sig,
+                                  unsigned long long siglen);
+
+/**
+ * Passes the next mlen bytes of the message.
+ * Returns -1 if the start of the signature has not been passed yet.
+ */
+int xmssmt_core_verify_msg_update(xmss_verify_stream *state,
+                                  const unsigned char *m,
+                                  unsigned long long mlen);
+
+/**
+ * Marks the message as complete, and processes the signature bytes that
+ * have been passed so far. From then on, signature bytes are processed as
+ * they are passed; for a detached signature, passing the message first
+ * overlaps all of the verification with receiving the signature.
+ */
+int xmssmt_core_verify_msg_final(xmss_verify_stream *state);
+
+/**
+ * Completes the verification and releases the state. The message is marked
+ * complete if it was not yet.
+ * Returns 0 if the signature is valid, -1 otherwise.
+ */
+int xmssmt_core_verify_finish(xmss_verify_stream *state);
+
+/*
+ * The XMSS variants. As XMSS is XMSS^MT with d = 1, these only differ in name.
+ */
+int xmss_core_verify_begin(const xmss_params *params,
+                           xmss_verify_stream *state,
+                           const unsigned char *pk);
+
+int xmss_core_verify_sig_update(xmss_verify_stream *state,
+                                const unsigned char *sig,
+                                unsigned long long siglen);
+
+int xmss_core_verify_msg_update(xmss_verify_stream *state,
+                                const unsigned char *m,
+                                unsigned long long mlen);
+
+int xmss_core_verify_msg_final(xmss_verify_stream *state);
+
+int xmss_core_verify_finish(xmss_verify_stream *state);
+
+#endif